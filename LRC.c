@@ -26,6 +26,7 @@ THIS SOFTWARE IS PROVIDED BY AT&T INTELLECTUAL PROPERTY ''AS IS'' AND ANY EXPRES
 #include <stdlib.h>
 #include <string.h>
 #include "jerasure.h"
+#include "jerasure_add.h"
 #include "reed_sol.h"
 
 #include "regenerating_codes.h"
@@ -44,62 +45,139 @@ Restriction: (f+1) has to be a multiple of n. The alphabet size 2^w>= n
 
 
 int encode_LRC(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info)
+{
+	int subpacket_size = input_size/(info->req.k*info->req.f);
+	return(encode_rc_region(input, output, subpacket_size, subpacket_size, info));
+}
+
+// the body of encode_LRC_iov(), see SPECIALIZED_LRC
+SPECIALIZABLE int encode_LRC_iov_body(char **data, char **output, int subpacket_size, int length, int n, int k, int f, struct coding_info *info)
 {
 	int i,j,c1;	
-	int n = info->req.n;
-	int k = info->req.k;
-	int f = info->req.f;	
-	int w = info->req.w;	
-	int subpacket_size = input_size/(k*f);
 	int num_of_groups = n/(f+1);
 	int base;
-	char **data_ptrs = malloc(sizeof(char*)*f);   
-	if(data_ptrs==NULL){
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_ptrs, **device_ptrs, **ptrs;
+	if(ws==NULL||(info->backend==BITMATRIX_BACKEND&&get_schedule(info)==NULL))
+		return(-1);
+	mark = workspace_mark(ws);
+	data_ptrs = workspace_alloc(ws, sizeof(char*)*f);   
+	device_ptrs = workspace_alloc(ws, sizeof(char*)*n);
+	ptrs = workspace_alloc(ws, sizeof(char*)*n);
+	if(data_ptrs==NULL||device_ptrs==NULL||ptrs==NULL){
 		printf("Out of memory.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}	     
 
-	for(i=0;i<k;i++)
-		memcpy(output[i],input+i*f*subpacket_size, f*subpacket_size);
-	jerasure_schedule_encode(k, n-k, w, info->schedule, output, (output+k), subpacket_size*f, ALIGNMENT);
+	for(i=0;i<k;i++){
+		for(c1=0;c1<f;c1++)
+			copy_region(output[i]+c1*subpacket_size, data[i*f+c1], length);
+	}
+	// the first f subpackets of the devices are a conventional (n,k) code
+	for(c1=0;c1<f;c1++){
+		for(i=0;i<n;i++)
+			device_ptrs[i] = output[i]+c1*subpacket_size;
+		if(encode_by_matrix(0, device_ptrs, (device_ptrs+k), ptrs, length, info)<0){
+			workspace_release(ws, mark);
+			return(-1);
+		}
+	}
 	for(i=0;i<num_of_groups;i++){
 		base = i*(f+1);
 		for(j=0;j<f+1;j++){
 			for(c1=0;c1<f;c1++)
 				data_ptrs[c1] = output[base+(j+c1)%(f+1)]+c1*subpacket_size;
-			jerasure_do_parity(f, data_ptrs, (output[base+(j+f)%(f+1)]+f*subpacket_size), subpacket_size);
+			xor_regions(data_ptrs, f, (output[base+(j+f)%(f+1)]+f*subpacket_size), length, 0);
 		}
 	}
 	
 	// clean-up
-	free(data_ptrs);       
+	workspace_release(ws, mark);
 	return(1);
 }
 
+#define ENCODE_LRC_SPECIALIZED(N,K,F) \
+	if(n==N&&k==K&&f==F) \
+		return(encode_LRC_iov_body(data, output, subpacket_size, length, N, K, F, info));
+
+// encodes bytes [0,length) of every subpacket, the buffers being laid out in subpackets of subpacket_size
+int encode_LRC_iov(char **data, char **output, int subpacket_size, int length, struct coding_info *info)
+{
+	int n = info->req.n;
+	int k = info->req.k;
+	int f = info->req.f;
+	SPECIALIZED_LRC(ENCODE_LRC_SPECIALIZED)
+	return(encode_LRC_iov_body(data, output, subpacket_size, length, n, k, f, info));
+}
+
+int make_decode_plan_LRC(struct decode_plan *plan, struct coding_info *info)
+{
+	plan->num_of_schedules = 1;
+	plan->erasures_array = calloc(1,sizeof(int*)); // NULL: the schedule is for plan->erasures itself
+	plan->schedule_array = calloc(1,sizeof(struct jerasure_flat_schedule*));
+	if(plan->erasures_array==NULL||plan->schedule_array==NULL){
+		printf("Out of memory.\n");
+		return(-1);
+	}
+	return(make_plan_decoding(plan, 0, 0, plan->erasures, info));
+}
+
 int decode_LRC(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info)
+{
+	int ret;
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	if(plan==NULL)
+		return(-1);
+	ret = decode_LRC_with_plan(input, input_size, output, output_size, plan, info);
+	free_decode_plan(plan);
+	return(ret);
+}
+
+int decode_LRC_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info)
+{
+	int subpacket_size = input_size/(info->req.f+1);	
+	return(decode_rc_region(input, output, subpacket_size, subpacket_size, plan, info));
+}
+
+int decode_LRC_iov(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info)
 {
 	int i, j, c1;
 	int n = info->req.n;
 	int k = info->req.k;
-	int w = info->req.w;
 	int f = info->req.f;
 	int base;
 	int num_of_groups = n/(f+1);
 	int target_device;
-	int subpacket_size = input_size/(f+1);	
-	int* erased = jerasure_erasures_to_erased(k,n-k,erasures);
-       
-	jerasure_schedule_decode_lazy(k,n-k,w,info->bitmatrix,erasures,input,(input+k),subpacket_size*f,ALIGNMENT,0);
-	
-	for(i=0;i<k;i++)
-		memcpy(output+i*f*subpacket_size,input[i], f*subpacket_size);
+	int* erased = plan->erased;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_ptrs, **device_ptrs, **ptrs;
+	if(ws==NULL)
+		return(-1);
 
 	// allocate memory for data arrangement
-	char **data_ptrs = malloc(sizeof(char*)*f); 	
-	if(data_ptrs==NULL){
+	mark = workspace_mark(ws);
+	data_ptrs = workspace_alloc(ws, sizeof(char*)*f); 	
+	device_ptrs = workspace_alloc(ws, sizeof(char*)*n);
+	ptrs = workspace_alloc(ws, sizeof(char*)*n);
+	if(data_ptrs==NULL||device_ptrs==NULL||ptrs==NULL){
 		printf("Out of memory.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}
+       
+	for(c1=0;c1<f;c1++){
+		for(i=0;i<n;i++)
+			device_ptrs[i] = input[i]+c1*subpacket_size;
+		decode_by_plan(plan,0,k,n-k,device_ptrs,(device_ptrs+k),ptrs,length,info);
+	}
+	
+	for(i=0;i<k;i++){
+		for(c1=0;c1<f;c1++)
+			place_region(&output[i*f+c1], input[i]+c1*subpacket_size, length);
+	}
 
 	for(i=0;i<num_of_groups;i++){
 		base = i*(f+1);
@@ -108,54 +186,74 @@ int decode_LRC(char **input, size_t input_size, char *output, size_t output_size
 			if(erased[target_device]==1){
 				for(c1=0;c1<f;c1++)
 					data_ptrs[c1] = input[base+(j+c1)%(f+1)]+c1*subpacket_size;
-				jerasure_do_parity(f, data_ptrs, (input[base+(j+f)%(f+1)]+f*subpacket_size), subpacket_size);
+				xor_regions(data_ptrs, f, (input[base+(j+f)%(f+1)]+f*subpacket_size), length, 0);
 			}
 		}
 	}
 	// clean-up
-	free(data_ptrs);
-	free(erased);
+	workspace_release(ws, mark);
 	return(1);
 
 }
 
 int repair_encode_LRC(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info)
 {
-	memcpy(output,input,input_size);		
+	copy_region(output,input,input_size);		
+	return(1);
+}
+
+int repair_encode_LRC_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info)
+{
+	int i;
+	for(i=0;i<info->req.f+1;i++)
+		copy_region(output+i*subpacket_size,input+i*subpacket_size,length);		
 	return(1);
 }
 
 int repair_decode_LRC(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info)
+{
+	int subpacket_size = input_size/(info->req.f+1);
+	return(repair_decode_LRC_region(input, output, subpacket_size, subpacket_size, to_device_ID, helpers, info));
+}
+
+int repair_decode_LRC_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info)
 {
 	int i,j,counter;	
 	int f = info->req.f;	
-	int subpacket_size = input_size/(f+1);
-	char **data_ptrs = malloc(sizeof(void*)*f);   
-	int *helpers_inv_ID = malloc(sizeof(int)*f);
 	int base = to_device_ID/(f+1)*(f+1);
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_ptrs;
+	int *helpers_inv_ID;
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	data_ptrs = workspace_alloc(ws, sizeof(void*)*f);   
+	helpers_inv_ID = workspace_alloc(ws, sizeof(int)*f);
 	if(data_ptrs==NULL||helpers_inv_ID==NULL){
 		printf("Out of memory.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}	     
 
-	for(i=0,counter;i<f;i++){
-		if(helpers[i]>=base&&helpers[i]<=base+f){
+	for(i=0,counter=0;i<f;i++){
+		if(helpers[i]>=base&&helpers[i]<=base+f&&helpers[i]!=to_device_ID){
 			helpers_inv_ID[(helpers[i]-to_device_ID+f)%(f+1)] = i;		
 			counter ++;
 		}		
 	}
 	if(counter<f){
 		printf("Insufficient number of helpers\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}
 	for(i=0;i<f+1;i++){
 		for(j=1;j<f+1;j++)
 			data_ptrs[j-1] = input[helpers_inv_ID[j-1]]+((i+j)%(f+1))*subpacket_size;		
-		jerasure_do_parity(f, data_ptrs, (output+i*subpacket_size), subpacket_size);
+		xor_regions(data_ptrs, f, (output+i*subpacket_size), length, 0);
 	}
 	
 	// clean-up
-	free(data_ptrs); 
-	free(helpers_inv_ID);      
+	workspace_release(ws, mark);
 	return(1);
 }
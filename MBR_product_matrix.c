@@ -54,86 +54,134 @@ Restriction: alphabet size 2^w>=(n-k+d)
 
 
 int encode_MBR_product_matrix(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info)
+{
+	int d = info->req.d;
+	int k = info->req.k;
+	int subpacket_size = input_size/(k*(k+1)/2+k*(d-k));
+	return(encode_rc_region(input, output, subpacket_size, subpacket_size, info));
+}
+
+// encodes bytes [0,length) of every subpacket, the buffers being laid out in subpackets of subpacket_size
+int encode_MBR_product_matrix_iov(char **data, char **output, int subpacket_size, int length, struct coding_info *info)
 {
 	int i,j, counter;	
 	int n = info->req.n;
 	int d = info->req.d;
 	int k = info->req.k;
-	int subpacket_size = input_size/(k*(k+1)/2+k*(d-k));
-	char **data_ptrs = malloc(sizeof(char*)*d*d); // this is the pointer matrix for the message matrix M
-	char **coding_ptrs = malloc(sizeof(char*)*(n-k)); // this is the pointers for holding encoded pieces
-	if(data_ptrs==NULL||coding_ptrs==NULL){
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_ptrs, **coding_ptrs, **ptrs;
+	if(ws==NULL||(info->backend==BITMATRIX_BACKEND&&(get_schedule(info)==NULL||get_subschedule(info,0)==NULL)))
+		return(-1);
+	mark = workspace_mark(ws);
+	data_ptrs = workspace_alloc(ws, sizeof(char*)*d*d); // this is the pointer matrix for the message matrix M
+	coding_ptrs = workspace_alloc(ws, sizeof(char*)*(n-k)); // this is the pointers for holding encoded pieces
+	ptrs = workspace_alloc(ws, sizeof(char*)*(n-k+d));
+	if(data_ptrs==NULL||coding_ptrs==NULL||ptrs==NULL){
 		printf("Cannot allocate memory!\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}
 
 	for(counter=0,i=0;i<d;i++){ // this is the d column in the matrix M,
 		for(j=0;j<i;j++)
 			data_ptrs[j+i*d] = data_ptrs[i+j*d];
-		for(j=i;j<d;j++)
-			data_ptrs[j+i*d] = input+subpacket_size*(counter+j-i);	
+		for(j=i;j<d;j++) // the rows after the k-th one only hold T', the rest of them is zero and never read
+			data_ptrs[j+i*d] = (i<k)?data[counter+j-i]:NULL;	
 		counter += d-i;		
 	}	
 
 	for(i=0;i<k;i++){
 		for(j=0;j<n-k;j++)
 			coding_ptrs[j] = output[j+k]+subpacket_size*i;
-		jerasure_schedule_encode(d, n-k, info->req.w, 
-				info->schedule,  data_ptrs+d*i, 
-				coding_ptrs, 
-				subpacket_size, ALIGNMENT);		
+		if(encode_by_matrix(0, data_ptrs+d*i, 
+				coding_ptrs, ptrs, 
+				length, info)<0){
+			workspace_release(ws, mark);
+			return(-1);
+		}
 		for(j=0;j<k;j++)
-			memcpy(output[j]+subpacket_size*i,data_ptrs[d*i+j],subpacket_size);
+			copy_region(output[j]+subpacket_size*i, data_ptrs[d*i+j], length);
 	}
 	for(i=k;i<d;i++){
 		for(j=0;j<n-k;j++)
 			coding_ptrs[j] = output[j+k]+subpacket_size*i;		
-		jerasure_schedule_encode(k, n-k, info->req.w, 
-				info->subschedule_array[0],  data_ptrs+d*i, coding_ptrs, 
-				subpacket_size, ALIGNMENT);
+		if(encode_by_matrix(1, data_ptrs+d*i, coding_ptrs, ptrs, 
+				length, info)<0){
+			workspace_release(ws, mark);
+			return(-1);
+		}
 		for(j=0;j<k;j++)
-			memcpy(output[j]+subpacket_size*i,data_ptrs[d*i+j],subpacket_size);
+			copy_region(output[j]+subpacket_size*i, data_ptrs[d*i+j], length);
 	}	
 	// clean up
-	free(data_ptrs);       
-	free(coding_ptrs);       
+	workspace_release(ws, mark);
 	return(1);
 }
 
+int make_decode_plan_MBR_product_matrix(struct decode_plan *plan, struct coding_info *info)
+{
+	// both the T portion and the columns of the S portion are decoded as an (n,k) code with the left k columns of [A B]
+	plan->num_of_schedules = 1;
+	plan->erasures_array = calloc(1,sizeof(int*)); // NULL: the schedule is for plan->erasures itself
+	plan->schedule_array = calloc(1,sizeof(struct jerasure_flat_schedule*));
+	if(plan->erasures_array==NULL||plan->schedule_array==NULL){
+		printf("Out of memory.\n");
+		return(-1);
+	}
+	return(make_plan_decoding(plan, 0, 1, plan->erasures, info));
+}
+
 int decode_MBR_product_matrix(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info)
+{
+	int ret;
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	if(plan==NULL)
+		return(-1);
+	ret = decode_MBR_product_matrix_with_plan(input, input_size, output, output_size, plan, info);
+	free_decode_plan(plan);
+	return(ret);
+}
+
+int decode_MBR_product_matrix_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info)
+{
+	int subpacket_size = input_size/info->req.d;
+	return(decode_rc_region(input, output, subpacket_size, subpacket_size, plan, info));
+}
+
+int decode_MBR_product_matrix_iov(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info)
 {
 	int i, j,counter = 0;
 	int n = info->req.n;
 	int d = info->req.d;
 	int k = info->req.k;
-	int subpacket_size = input_size/d;
-	int num_of_long = subpacket_size/sizeof(long);	
-	long *src_pos,*des_pos;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_plus_coding_ptrs, **to_be_XORed, **ptrs, *XOR_buffer;
+	if(ws==NULL||(info->backend==BITMATRIX_BACKEND&&get_subschedule(info,1)==NULL))
+		return(-1);
        
 	// allocate memory for data arrangement
-	char** data_plus_coding_ptrs = malloc(sizeof(char*)*n);
-	char** to_be_XORed = malloc(sizeof(char*)*(n-k));
-	for(i=0;i<n-k;i++)
-		to_be_XORed[i] = malloc(subpacket_size);
-	if(data_plus_coding_ptrs==NULL||to_be_XORed==NULL||to_be_XORed[0]==NULL){
+	mark = workspace_mark(ws);
+	data_plus_coding_ptrs = workspace_alloc(ws, sizeof(char*)*n);
+	to_be_XORed = workspace_alloc(ws, sizeof(char*)*(n-k));
+	ptrs = workspace_alloc(ws, sizeof(char*)*(n+d));
+	XOR_buffer = workspace_alloc(ws, (size_t)length*(n-k));
+	if(data_plus_coding_ptrs==NULL||to_be_XORed==NULL||ptrs==NULL||XOR_buffer==NULL){
 		printf("Out of memory.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}
-	// convert erasures into erased format for easy processing 
-	int* erased=jerasure_erasures_to_erased(n, n-info->req.k, erasures);
-	if(erased==NULL){
-		printf("Too many erasures, can not recover.\n");
-		goto complete;
-	}
+	for(i=0;i<n-k;i++)
+		to_be_XORed[i] = XOR_buffer+(size_t)i*length;
 	// first decode the T portion of the matrix M, this also repairs the T portion of the coded info
 	for(i=0; i<d-k ; i++){
 		for(j=0;j<n;j++)
 			data_plus_coding_ptrs[j] = input[j]+(i+k)*subpacket_size;
-		jerasure_schedule_decode_lazy(k, n-k, info->req.w, 
-				info->subbitmatrix_array[0], erasures, 
+		decode_by_plan(plan, 0, k, n-k, 
 				data_plus_coding_ptrs, 
-				data_plus_coding_ptrs+k, 	
-			        subpacket_size, ALIGNMENT, 0);
+				data_plus_coding_ptrs+k, ptrs, 	
+			        length, info);
 	}
 	
 	// next decode the S portion of the matrix M
@@ -143,110 +191,294 @@ int decode_MBR_product_matrix(char **input, size_t input_size, char *output, siz
 		for(j=0;j<d-k;j++)
 			data_plus_coding_ptrs[j] = input[i]+subpacket_size*(k+j);
 		
-		jerasure_schedule_encode(d-k, n-k, info->req.w, 
-			info->subschedule_array[1], data_plus_coding_ptrs, to_be_XORed, 
-			subpacket_size, ALIGNMENT);
+		if(encode_by_matrix(2, data_plus_coding_ptrs, to_be_XORed, ptrs, 
+			length, info)<0){
+			workspace_release(ws, mark);
+			return(-1);
+		}
 		
+		// cancel it out of the surviving coded info in the scratch buffer, the input devices are only read
+		for(j=0;j<k;j++)
+			data_plus_coding_ptrs[j] = input[j]+i*subpacket_size;
 		for(j=0;j<n-k;j++){
-			des_pos = (long*)(input[k+j]+i*subpacket_size);
-			src_pos = (long*)(to_be_XORed[j]);
-			for(counter=0;counter<num_of_long;counter++,des_pos++,src_pos++)
-				*des_pos ^= *src_pos;							
+			if(plan->erased[k+j]==1){
+				data_plus_coding_ptrs[k+j] = input[k+j]+i*subpacket_size;
+				continue;
+			}
+			xor_region(input[k+j]+i*subpacket_size, to_be_XORed[j], length);
+			data_plus_coding_ptrs[k+j] = to_be_XORed[j];
 		}
 
-		for(j=0;j<n;j++)
-			data_plus_coding_ptrs[j] = input[j]+i*subpacket_size;
-
 		// then we can decode 
-		jerasure_schedule_decode_lazy(k, n-k, info->req.w, 
-				info->subbitmatrix_array[0], erasures, 
+		decode_by_plan(plan, 0, k, n-k, 
 				data_plus_coding_ptrs, 
-				data_plus_coding_ptrs+k, 	
-			        subpacket_size, ALIGNMENT, 0);
-		//write the XOR part back to the correct coded info
+				data_plus_coding_ptrs+k, ptrs, 	
+			        length, info);
+		// add the XOR part to the repaired coded info
 		for(j=0;j<n-k;j++){
-			des_pos = (long*)(input[k+j]+i*subpacket_size);
-			src_pos = (long*)(to_be_XORed[j]);
-			for(counter=0;counter<num_of_long;counter++,des_pos++,src_pos++)
-				*des_pos ^= *src_pos;	
+			if(plan->erased[k+j]==0)
+				continue;
+			xor_region(to_be_XORed[j], input[k+j]+i*subpacket_size, length);
 		}
 	}
 
 	// extract data from M matrix and copy to output buffer
 	for(counter=0,i=0;i<k;i++){ 
-		memcpy(output+counter*subpacket_size,input[i]+i*subpacket_size,subpacket_size*(d-i));
-		counter += d-i;		
+		for(j=i;j<d;j++,counter++)
+			place_region(&output[counter], input[i]+j*subpacket_size, length);
 	}
 
 	// clean up
-complete:
-	free(data_plus_coding_ptrs);
-	free(erased);
-	for(i=0;i<n-k;i++)
-		free(to_be_XORed[i]);
-	free(to_be_XORed);	
+	workspace_release(ws, mark);
 	return(1);
 }
 
 int repair_encode_MBR_product_matrix(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info)
 {
-	int d = info->req.d;
-	int k = info->req.k;
-	int w = info->req.w;
-	int subpacket_size = input_size/d;	
-	int i;
+	int subpacket_size = input_size/info->req.d;	
 	if(subpacket_size!=output_size){
 		printf("Incorrect buffer size.\n");
 		return(-1);
 	}
-	char** data_ptrs = malloc(sizeof(char*)*d);
-	if(data_ptrs==NULL)
+	return(repair_encode_MBR_product_matrix_region(input, output, subpacket_size, subpacket_size, from_device_ID, to_device_ID, info));
+}
+
+int repair_encode_MBR_product_matrix_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info)
+{
+	int d = info->req.d;
+	int k = info->req.k;
+	int i;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char** data_ptrs;
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	data_ptrs = workspace_alloc(ws, sizeof(char*)*d);
+	if(data_ptrs==NULL){
+		workspace_release(ws, mark);
 		return(-1);
+	}
 	// repair here needs an encoding step
 	if(to_device_ID<k)//just copy that single position
-		memcpy(output,input+subpacket_size*to_device_ID,subpacket_size);
+		copy_region(output,input+subpacket_size*to_device_ID,length);
 	else{ // otherwise need do real computation, but it can be thought as an encoding step 
+		if(info->backend==BITMATRIX_BACKEND&&get_bitmatrix(info)==NULL){
+			workspace_release(ws, mark);
+			return(-1);
+		}
 		for(i=0;i<d;i++)
 			data_ptrs[i] = input+i*subpacket_size;
-		jerasure_bitmatrix_encode(d,1,w,info->bitmatrix+d*w*(to_device_ID-k)*w,data_ptrs,&output,subpacket_size,ALIGNMENT);
+		dotprod_by_matrix(0,to_device_ID-k,data_ptrs,output,length,info);
 	}	
-	free(data_ptrs);	
+	workspace_release(ws, mark);
 	return(1);
 }
-int repair_decode_MBR_product_matrix(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info)
+// builds the repair coefficients for the newcomer entry->to_device_ID from the helpers entry->helpers
+static int make_repair_entry_MBR_product_matrix(struct repair_entry *entry, struct coding_info *info)
 {
-
-	int i,counter;
+	int i;
 	int d = info->req.d;	
 	int k = info->req.k;
 	int w = info->req.w;
-	int subpacket_size = output_size/d;
-	char** coding_ptrs = malloc(sizeof(void*)*d);
 	int *repair_matrix = malloc(sizeof(int)*d*d);
 	int *repair_matrix_inv = malloc(sizeof(int)*d*d);
 
+	if(repair_matrix==NULL||repair_matrix_inv==NULL){
+		printf("Can not allocate memory\n");
+		free(repair_matrix);
+		free(repair_matrix_inv);
+		return(-1);
+	}
 	memset(repair_matrix,0,sizeof(int)*d*d);
-	for(i=0,counter=0;i<d&&helpers[i]>=0;i++){
-		counter ++;
-		if(helpers[i]<k)
-			repair_matrix[i*d+helpers[i]]=1;
+	for(i=0;i<d;i++){
+		if(entry->helpers[i]<k)
+			repair_matrix[i*d+entry->helpers[i]]=1;
 		else			
-			memcpy(repair_matrix+d*i,info->matrix+(helpers[i]-k)*d,sizeof(int)*d);
+			memcpy(repair_matrix+d*i,info->matrix+(entry->helpers[i]-k)*d,sizeof(int)*d);
 	}	
+	if(jerasure_invert_matrix(repair_matrix,repair_matrix_inv,d,w)<0){
+		printf("The helpers can not repair the failed device.\n");
+		free(repair_matrix);
+		free(repair_matrix_inv);
+		return(-1);
+	}
+	entry->matrix = repair_matrix_inv;
+	if(info->backend==BITMATRIX_BACKEND){
+		entry->bitmatrix = jerasure_matrix_to_bitmatrix(d,d,w,repair_matrix_inv);
+		entry->schedule = jerasure_smart_bitmatrix_to_schedule(d,d,w,entry->bitmatrix);
+	}
+
+	free(repair_matrix);
+	return(1);
+}
+
+int repair_decode_MBR_product_matrix(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info)
+{
+
+	int i,counter;
+	int d = info->req.d;	
+	int subpacket_size = output_size/d;
+
+	for(i=0,counter=0;i<d&&helpers[i]>=0;i++,counter++);
 	if(counter<d){
 		printf("Insufficient number of helpers.\n");
 		return(-1);
 	}
-	jerasure_invert_matrix(repair_matrix,repair_matrix_inv,d,w);
+	return(repair_decode_MBR_product_matrix_region(input, output, subpacket_size, subpacket_size, to_device_ID, helpers, info));
+}
 
+int repair_decode_MBR_product_matrix_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info)
+{
+	int i;
+	int d = info->req.d;	
+	char **coding_ptrs, **ptrs;
+	struct repair_entry *entry;
+	struct workspace *ws;
+	size_t mark;
+
+	ws = get_workspace(info);
+	if(ws==NULL)
+		return(-1);
+	entry = get_repair_entry(to_device_ID, helpers, info, make_repair_entry_MBR_product_matrix);
+	if(entry==NULL)
+		return(-1);
+
+	mark = workspace_mark(ws);
+	coding_ptrs = workspace_alloc(ws, sizeof(void*)*d);
+	ptrs = workspace_alloc(ws, sizeof(void*)*2*d);
+	if(coding_ptrs==NULL||ptrs==NULL){
+		printf("Out of memory.\n");
+		put_repair_entry(entry, info);
+		workspace_release(ws, mark);
+		return(-1);
+	}
 	for(i=0; i<d ;i++)
 		coding_ptrs[i] = output + i*subpacket_size;
-	int *coding_bitmatrix = jerasure_matrix_to_bitmatrix(d,d,w,repair_matrix_inv);
-	jerasure_bitmatrix_encode(d,d,w,coding_bitmatrix,(char**)input,coding_ptrs,subpacket_size,ALIGNMENT);
+	encode_by_entry(entry,d,d,(char**)input,coding_ptrs,ptrs,length,info);
 
-	free(coding_ptrs);
-	free(repair_matrix);
-	free(repair_matrix_inv);
-	free(coding_bitmatrix);
+	put_repair_entry(entry, info);
+	workspace_release(ws, mark);
 	return(1);
 }
+
+#define MBR_SEARCH_ROUNDS 8
+#define MBR_SEARCH_POINTS 256
+
+// the entries scales[j]/(x+others[j]) of a row (or a column) of a Cauchy matrix, returns the best scale of them 
+// and their number of ones in *cost
+static int scale_cauchy_line(int x, int *others, int *scales, int num, int scale, int *elts, int *ones, int *cost, int w)
+{
+	int j;
+
+	for(j=0;j<num;j++)
+		elts[j] = galois_single_divide(scales[j],x^others[j],w);
+	return(jerasure_best_scale(elts,num,w,ones,scale,cost));
+}
+
+// searches the (n-k)-by-d encoding matrix with the fewest ones in its bitmatrix among the Cauchy matrices 
+// r_i*s_j/(x_i+y_j) with distinct points x_i, y_j among the first MBR_SEARCH_POINTS field elements, all of 
+// which keep every square submatrix invertible. Returns the matrix, or NULL if the field is too large to search
+// or if the result does not beat cauchy_good_general_coding_matrix().
+int* search_MBR_product_matrix(struct coding_info *info)
+{
+	int m = info->req.n-info->req.k;
+	int d = info->req.d;
+	int w = info->req.w;
+	int pool = MIN(1<<w,MBR_SEARCH_POINTS);
+	int *ones, *x, *y, *r, *s, *used, *elts, *matrix, *good;
+	int i,j,v,round,improved,scale,cost,best_v,best_scale,best_cost,total;
+
+	if(pool<m+d)
+		return(NULL);
+	ones = jerasure_make_ones_table(w);
+	if(ones==NULL)
+		return(NULL);
+	x = talloc(int, m);
+	r = talloc(int, m);
+	y = talloc(int, d);
+	s = talloc(int, d);
+	used = talloc(int, pool);
+	elts = talloc(int, MAX(m,d));
+	matrix = talloc(int, m*d);
+	if(x==NULL||r==NULL||y==NULL||s==NULL||used==NULL||elts==NULL||matrix==NULL){
+		printf("Can not allocate memory.\n");
+		free(ones); free(x); free(r); free(y); free(s); free(used); free(elts); free(matrix);
+		return(NULL);
+	}
+	// the points of cauchy_original_coding_matrix()
+	memset(used,0,sizeof(int)*pool);
+	for(i=0;i<m;i++){
+		x[i] = i;
+		r[i] = 1;
+		used[i] = 1;
+	}
+	for(j=0;j<d;j++){
+		y[j] = m+j;
+		s[j] = 1;
+		used[m+j] = 1;
+	}
+
+	for(round=0,improved=1;round<MBR_SEARCH_ROUNDS&&improved;round++){
+		improved = 0;
+		for(i=0;i<m;i++){
+			best_v = x[i];
+			best_scale = scale_cauchy_line(x[i],y,s,d,r[i],elts,ones,&best_cost,w);
+			for(v=0;v<pool;v++){
+				if(used[v])
+					continue;
+				scale = scale_cauchy_line(v,y,s,d,1,elts,ones,&cost,w);
+				if(cost<best_cost){
+					best_v = v;
+					best_scale = scale;
+					best_cost = cost;
+				}
+			}
+			if(best_v!=x[i]||best_scale!=r[i])
+				improved = 1;
+			used[x[i]] = 0;
+			used[best_v] = 1;
+			x[i] = best_v;
+			r[i] = best_scale;
+		}
+		for(j=0;j<d;j++){
+			best_v = y[j];
+			best_scale = scale_cauchy_line(y[j],x,r,m,s[j],elts,ones,&best_cost,w);
+			for(v=0;v<pool;v++){
+				if(used[v])
+					continue;
+				scale = scale_cauchy_line(v,x,r,m,1,elts,ones,&cost,w);
+				if(cost<best_cost){
+					best_v = v;
+					best_scale = scale;
+					best_cost = cost;
+				}
+			}
+			if(best_v!=y[j]||best_scale!=s[j])
+				improved = 1;
+			used[y[j]] = 0;
+			used[best_v] = 1;
+			y[j] = best_v;
+			s[j] = best_scale;
+		}
+	}
+
+	for(i=0,total=0;i<m;i++){
+		for(j=0;j<d;j++){
+			matrix[i*d+j] = galois_single_multiply(r[i],galois_single_divide(s[j],x[i]^y[j],w),w);
+			total += ones[matrix[i*d+j]];
+		}
+	}
+	good = cauchy_good_general_coding_matrix(d, m, w);
+	if(good!=NULL){
+		for(i=0;i<m*d;i++)
+			total -= ones[good[i]];
+		free(good);
+	}
+	free(ones); free(x); free(r); free(y); free(s); free(used); free(elts);
+	if(good!=NULL&&total>=0){
+		free(matrix);
+		return(NULL);
+	}
+	return(matrix);
+}
@@ -64,14 +64,27 @@ Restriction: this construction works only for d=n-1. The alphabet size 2^w >= n*
 
 int encode_MBR_repair_by_transfer(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info)
 {
-	int i,j,counter;	
-	int n = info->req.n;
 	int subpacket_size = input_size/info->req.inner_k;
-	char **data_plus_coding_ptrs = malloc(sizeof(char*)*info->req.inner_n);        
+	return(encode_rc_region(input, output, subpacket_size, subpacket_size, info));
+}
+
+// the body of encode_MBR_repair_by_transfer_iov(), see SPECIALIZED_MBR_RBT
+SPECIALIZABLE int encode_MBR_repair_by_transfer_iov_body(char **data, char **output, int subpacket_size, int length, int n, int inner_n, int inner_k, struct coding_info *info)
+{
+	int i,j,counter;	
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_plus_coding_ptrs, **ptrs;
+	if(ws==NULL||(info->backend==BITMATRIX_BACKEND&&get_schedule(info)==NULL))
+		return(-1);
+	mark = workspace_mark(ws);
+	data_plus_coding_ptrs = workspace_alloc(ws, sizeof(char*)*inner_n);        
+	ptrs = workspace_alloc(ws, sizeof(char*)*inner_n);
   
 	// rearrange the memory pointers in preparation for encoding
-	if(data_plus_coding_ptrs==NULL){
+	if(data_plus_coding_ptrs==NULL||ptrs==NULL){
 		printf("Out of memory.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}	
 	for(counter=0,i=0; i<n;i++){ // i-th device, or i-th column	
@@ -82,63 +95,122 @@ int encode_MBR_repair_by_transfer(char *input, size_t input_size, char **output,
 	}	
         
 	// now copy the data content into the output buffer
-	for(counter=0;counter<info->req.inner_k;counter++)
-		memcpy(data_plus_coding_ptrs[counter],input+subpacket_size*counter,subpacket_size);	
+	for(counter=0;counter<inner_k;counter++)
+		copy_region(data_plus_coding_ptrs[counter], data[counter], length);	
         
 	// call jerasure routine for encoding;
-	jerasure_schedule_encode(info->req.inner_k, info->req.inner_n-info->req.inner_k, info->req.w, 
-				info->schedule, data_plus_coding_ptrs, 
-				(data_plus_coding_ptrs+info->req.inner_k), 
-				subpacket_size, ALIGNMENT);
+	if(encode_by_matrix(0, data_plus_coding_ptrs, 
+				(data_plus_coding_ptrs+inner_k), ptrs, 
+				length, info)<0){
+		workspace_release(ws, mark);
+		return(-1);
+	}
 	
 	// now replicate data using the symbol placement pattern specified above	
 	for(counter=0,j=0; j<n-1;j++){ // j-th subpacket, or j-th row
 		for(i=j+1;i<n;i++){ // i-th column, or i-th device				
-			memcpy(output[i]+j*subpacket_size,data_plus_coding_ptrs[counter],subpacket_size);	
+			copy_region(output[i]+j*subpacket_size,data_plus_coding_ptrs[counter],length);	
 			counter++;				
 		}
 	}
 	// clean up
-	free(data_plus_coding_ptrs);       
+	workspace_release(ws, mark);
 	return(1);
 }
 
-int decode_MBR_repair_by_transfer(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info)
+#define ENCODE_MBR_RBT_SPECIALIZED(N,K) \
+	if(n==N&&info->req.k==K) \
+		return(encode_MBR_repair_by_transfer_iov_body(data, output, subpacket_size, length, N, N*(N-1)/2, K*N-K*(K+1)/2, info));
+
+// encodes bytes [0,length) of every subpacket, the buffers being laid out in subpackets of subpacket_size
+int encode_MBR_repair_by_transfer_iov(char **data, char **output, int subpacket_size, int length, struct coding_info *info)
 {
-	int i, j, counter = 0, num_erasures=0;
 	int n = info->req.n;
-	int subpacket_size = input_size/(n-1);	
-	int* erased;	
-	int* pseudo_erasures=calloc(info->req.inner_n,sizeof(int));
-	if(pseudo_erasures==NULL){		
+	SPECIALIZED_MBR_RBT(ENCODE_MBR_RBT_SPECIALIZED)
+	return(encode_MBR_repair_by_transfer_iov_body(data, output, subpacket_size, length, n, info->req.inner_n, info->req.inner_k, info));
+}
+
+int make_decode_plan_MBR_repair_by_transfer(struct decode_plan *plan, struct coding_info *info)
+{
+	int i, j, counter, num_erasures=0;
+	int n = info->req.n;
+	int* erased = plan->erased;
+	int* pseudo_erasures;
+
+	plan->num_of_schedules = 1;
+	plan->erasures_array = calloc(1,sizeof(int*));
+	plan->erased_array = calloc(1,sizeof(int*));
+	plan->schedule_array = calloc(1,sizeof(struct jerasure_flat_schedule*));
+	pseudo_erasures = malloc(sizeof(int)*(info->req.inner_n+1));
+	if(plan->erasures_array==NULL||plan->erased_array==NULL||plan->schedule_array==NULL||pseudo_erasures==NULL){
 		printf("Out of memory.\n");
+		if(pseudo_erasures!=NULL) free(pseudo_erasures);
+		return(-1);
+	}
+	plan->erasures_array[0] = pseudo_erasures;
+	// a symbol of the inner code is lost only if both devices holding a copy of it are erased
+	for(counter=0,i=0;i<n;i++){  //i-th device	 		
+		for (j=i;j<n-1;j++){	// j-th row			
+			if(erased[i]==1&&erased[j+1]==1){
+				pseudo_erasures[num_erasures] = counter;
+				num_erasures++;
+			}
+			counter++;
+		}
+	}
+	pseudo_erasures[num_erasures] = -1;
+	plan->erased_array[0] = jerasure_erasures_to_erased(info->req.inner_k, info->req.inner_n-info->req.inner_k, pseudo_erasures);
+	if(plan->erased_array[0]==NULL){
+		printf("Too many erasures, can not recover.\n");
+		return(-1);
+	}
+	return(make_plan_decoding(plan, 0, 0, pseudo_erasures, info));
+}
+
+int decode_MBR_repair_by_transfer(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info)
+{
+	int ret;
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	if(plan==NULL)
+		return(-1);
+	ret = decode_MBR_repair_by_transfer_with_plan(input, input_size, output, output_size, plan, info);
+	free_decode_plan(plan);
+	return(ret);
+}
+
+int decode_MBR_repair_by_transfer_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info)
+{
+	int subpacket_size = input_size/(info->req.n-1);	
+	return(decode_rc_region(input, output, subpacket_size, subpacket_size, plan, info));
+}
+
+int decode_MBR_repair_by_transfer_iov(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info)
+{
+	int i, j, counter = 0;
+	int n = info->req.n;
+	int* erased = plan->erased;	
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_plus_coding_ptrs, **ptrs;
+	if(ws==NULL)
 		return(-1);
-	} 
        
 	// allocate memory for data arrangement
-	char** data_plus_coding_ptrs = malloc(sizeof(void*)*info->req.inner_n);
-	if(data_plus_coding_ptrs==NULL){
+	mark = workspace_mark(ws);
+	data_plus_coding_ptrs = workspace_alloc(ws, sizeof(void*)*info->req.inner_n);
+	ptrs = workspace_alloc(ws, sizeof(void*)*info->req.inner_n);
+	if(data_plus_coding_ptrs==NULL||ptrs==NULL){
 		printf("Out of memory.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}
-	// convert erasures into erased format for easy processing 
-	erased=jerasure_erasures_to_erased(n, n-info->req.k, erasures);
-	if(erased==NULL){
-		printf("Too many erasures, can not recover.\n");
-		goto complete;
-	}
 	// assign buffer pointers in preparation for decoding	
 	for(counter=0,i=0;i<n;i++){  //i-th device	 		
 		if(erased[i]==1){
 			for (j=i;j<n-1;j++){	// j-th row			
 				data_plus_coding_ptrs[counter] = input[i]+j*subpacket_size;
-				if(erased[j+1]==1) // yes, this subpacket is indeed lost
-				{
-					pseudo_erasures[num_erasures] = counter;
-					num_erasures++;					
-				}
-				else
-					memcpy(data_plus_coding_ptrs[counter],input[j+1]+i*subpacket_size,subpacket_size);
+				if(erased[j+1]==0) // the copy on device j+1 survived
+					copy_region(data_plus_coding_ptrs[counter],input[j+1]+i*subpacket_size,length);
 				counter++;
 			}
 		}
@@ -149,31 +221,27 @@ int decode_MBR_repair_by_transfer(char **input, size_t input_size, char *output,
 			}
 		}
 	}
-	pseudo_erasures[num_erasures] = -1;
 
 	// call jerasure routine for decoding
-	jerasure_schedule_decode_lazy(info->req.inner_k, info->req.inner_n-info->req.inner_k, info->req.w, 
-				info->bitmatrix, pseudo_erasures, 
+	decode_by_plan(plan, 0, info->req.inner_k, info->req.inner_n-info->req.inner_k, 
 				data_plus_coding_ptrs, 
-				(data_plus_coding_ptrs+info->req.inner_k), 	
-			        subpacket_size, ALIGNMENT, 0);
+				(data_plus_coding_ptrs+info->req.inner_k), ptrs, 	
+			        length, info);
 
-	// replicate data using the symbol placement pattern, which repairs all the lost devices also	
+	// replicate data using the symbol placement pattern, which repairs all the lost devices also.
+	// The surviving devices already hold their copies and are not written.
 	for(j=0, counter = 0; j<n-1;j++){ // j-th subpacket, or j-th row
 		for(i=j+1;i<n;i++){ // i-th column, or i-th device				
-			memcpy(input[i]+j*subpacket_size,data_plus_coding_ptrs[counter],subpacket_size);			
+			if(erased[i]==1)
+				copy_region(input[i]+j*subpacket_size,data_plus_coding_ptrs[counter],length);			
 			counter++;				
 		}
 	}	
 	for(counter=0;counter<info->req.inner_k;counter++)
-		memcpy(output+subpacket_size*counter,data_plus_coding_ptrs[counter],subpacket_size);	
+		place_region(&output[counter], data_plus_coding_ptrs[counter], length);	
 	
 	// clean up
-	free(erased);
-complete:
-	free(data_plus_coding_ptrs);
-	free(pseudo_erasures);
-	
+	workspace_release(ws, mark);
 	return(1);
 }
 
@@ -185,21 +253,42 @@ int repair_encode_MBR_repair_by_transfer(char *input, size_t input_size, char *o
 		printf("Incorrect buffer size.\n");
 		return(-1);
 	}
+	return(repair_encode_MBR_repair_by_transfer_region(input, output, subpacket_size, subpacket_size, from_device_ID, to_device_ID, info));
+}
+
+int repair_encode_MBR_repair_by_transfer_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info)
+{
 	// repair encoding is a simple copy operation
 	if(from_device_ID<to_device_ID)
-		memcpy(output,input+subpacket_size*(to_device_ID-1),subpacket_size);	
+		copy_region(output,input+subpacket_size*(to_device_ID-1),length);	
 	else
-		memcpy(output,input+subpacket_size*to_device_ID,subpacket_size);		
+		copy_region(output,input+subpacket_size*to_device_ID,length);		
 	
 	return(1);
 }
 
 int repair_decode_MBR_repair_by_transfer(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info)
+{
+	int subpacket_size = output_size/(info->req.n-1);
+	return(repair_decode_MBR_repair_by_transfer_region(input, output, subpacket_size, subpacket_size, to_device_ID, helpers, info));
+}
+
+int repair_decode_MBR_repair_by_transfer_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info)
 {
 	int i,counter;
 	int n = info->req.n;
-	int subpacket_size = output_size/(n-1);
-	int* helpers_inv_ID = malloc(sizeof(int)*n);
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	int* helpers_inv_ID;
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	helpers_inv_ID = workspace_alloc(ws, sizeof(int)*n);
+	if(helpers_inv_ID==NULL){
+		printf("Out of memory.\n");
+		workspace_release(ws, mark);
+		return(-1);
+	}
 	for(i=0,counter=0;i<n-1&&helpers[i]>=0;i++){		
 		counter++;
 		if(helpers[i]<to_device_ID)
@@ -209,12 +298,13 @@ int repair_decode_MBR_repair_by_transfer(char **input, size_t input_size, char *
 	}
 	if(counter<info->req.d){
 		printf("Insufficient number of helpers.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}
 
 	// repair decoding is also a simple copy operation following the right order
 	for(i=0;i<n-1;i++)        
-		memcpy(output+subpacket_size*i,input[helpers_inv_ID[i]],subpacket_size);	
-	free(helpers_inv_ID);
+		copy_region(output+subpacket_size*i,input[helpers_inv_ID[i]],length);	
+	workspace_release(ws, mark);
 	return(1);
 }
@@ -57,417 +57,912 @@ We group the subpackets together in order to simplify the disk io where each dev
 Restriction: alphabet size 2^w>=n.
 */
 
-int decode_MSR_product_matrix_no_output(char **input, size_t input_size, int* erasures, struct coding_info *info);
+int decode_MSR_product_matrix_no_output(char **input, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info);
 
 int encode_MSR_product_matrix(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info)
 {
-	int i;	
-	int n = info->req.n;	
+	int subpacket_size = output_size/(info->req.d-info->req.k+1);
+	return(encode_rc_region(input, output, subpacket_size, subpacket_size, info));
+}
+
+int encode_MSR_product_matrix_iov(char **data, char **output, int subpacket_size, int length, struct coding_info *info)
+{
+	int i,j;	
+	int n = info->req.n;
+	int d = info->req.d;
 	int k = info->req.k;	
-	int *erasures = malloc(sizeof(int)*n);
-	for(i=0;i<n-k;i++)	
-		erasures[i] = i+k;
-	erasures[n-k] = -1;
+	int alpha = d-k+1;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **subpacket_ptrs, **ptrs;
 
-	for(i=0;i<k;i++)
-		memcpy(output[i],input+output_size*i,output_size);		
-	if(decode_MSR_product_matrix_no_output(output,output_size,erasures,info)<0){
-		free(erasures);	return(-1);
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	subpacket_ptrs = workspace_alloc(ws, sizeof(char*)*n*alpha);
+	ptrs = workspace_alloc(ws, sizeof(char*)*(n*alpha+1));
+	if(subpacket_ptrs==NULL||ptrs==NULL){
+		printf("Out of memory.\n");
+		workspace_release(ws, mark);
+		return(-1);
+	}
+	for(i=0;i<n;i++)
+		for(j=0;j<alpha;j++)
+			subpacket_ptrs[i*alpha+j] = output[i]+j*subpacket_size;
+	for(i=0;i<k*alpha;i++)
+		copy_region(subpacket_ptrs[i], data[i], length);		
+	// the parity is a fixed linear function of the systematic subpackets, see make_MSR_systematic_generator()
+	if(encode_by_matrix(5, subpacket_ptrs, subpacket_ptrs+k*alpha, ptrs, length, info)<0){
+		workspace_release(ws, mark);
+		return(-1);
 	}
-	free(erasures);
+	workspace_release(ws, mark);
 	return(1);
 }
 
-int decode_MSR_product_matrix_no_output(char **input, size_t input_size, int* erasures, struct coding_info *info)
+static int* make_MSR_symbol_matrix(struct coding_info *info);
+
+// the collapsed decoding: row e*(d-k+1)+j gives subpacket j of the e-th erased systematic device from the subpackets of 
+// the remaining devices, subpacket j of plan->remaining[i] being column i*(d-k+1)+j. That is E_erased * E_remaining^-1, 
+// E being the map from the info symbols of M to the coded subpackets, see make_MSR_systematic_generator().
+static int make_collapsed_plan_MSR_product_matrix(struct decode_plan *plan, struct coding_info *info)
 {
-	clock_t clk, tclk;
-	int i, j,c1,c2,tdone,inv;
+	int i, e;
+	int k = info->req.k;
+	int w = info->req.w;
+	int alpha = info->req.d-k+1;
+	int symbols = k*alpha;
+	int *E, *E_remaining, *inverse, *map = NULL;
+
+	for(i=0,e=0;plan->erasures[i]!=-1;i++)
+		if(plan->erasures[i]<k)
+			e++;
+	E = make_MSR_symbol_matrix(info);
+	E_remaining = talloc(int, symbols*symbols);
+	inverse = talloc(int, symbols*symbols);
+	if(E==NULL||E_remaining==NULL||inverse==NULL){
+		printf("Can not allocate memory\n");
+		goto complete;
+	}
+	for(i=0;i<k;i++)
+		memcpy(E_remaining+i*alpha*symbols,E+plan->remaining[i]*alpha*symbols,sizeof(int)*alpha*symbols);
+	if(jerasure_invert_matrix(E_remaining,inverse,symbols,w)<0){
+		printf("The remaining devices can not rebuild the data.\n");
+		goto complete;
+	}
+	// the rows of the erased systematic devices, gathered at the start of E_remaining
+	for(i=0,e=0;plan->erasures[i]!=-1;i++){
+		if(plan->erasures[i]<k){
+			memcpy(E_remaining+e*alpha*symbols,E+plan->erasures[i]*alpha*symbols,sizeof(int)*alpha*symbols);
+			e++;
+		}
+	}
+	map = e==0?talloc(int, 1):jerasure_matrix_multiply(E_remaining,inverse,e*alpha,symbols,symbols,symbols,w);
+	if(map==NULL)
+		printf("Can not allocate memory\n");
+complete:
+	free(E);
+	free(E_remaining);
+	free(inverse);
+	if(map==NULL)
+		return(-1);
+	return(make_plan_collapsed(plan, map, symbols, e*alpha, info));
+}
+
+// the schedules of a plan: 0 and 1 decode T and Z, then come the solves of \tilde{S_1} and \tilde{S_2}, which only depend
+// on the remaining devices: the multiply by inv(\Phi_{DC1}), the diagonal of column i, and the two entries (s=0 for
+// \tilde{S_1}, 1 for \tilde{S_2}) of the off-diagonal pair (i,j), i<j
+#define MSR_PLAN_INVERSE 2
+#define MSR_PLAN_DIAGONAL(i) (3+(i))
+#define MSR_PLAN_PAIR(i,j,s,k) (3+(k)-1+2*((i)*((k)-1)+(j))+(s))
+#define MSR_PLAN_SCHEDULES(k) (3+(k)-1+2*((k)-1)*((k)-1))
+
+// makes the solve schedules of the plan, see MSR_PLAN_INVERSE
+static int make_solve_plan_MSR_product_matrix(struct decode_plan *plan, struct coding_info *info)
+{
+	int i, j, inv, ret = -1;
+	int k = info->req.k;
+	int d = info->req.d;
+	int w = info->req.w;
+	int *lambda = info->lambda;
+	int *remaining = plan->remaining;
+	int *phi, *phi_inv, *vector_A = NULL, *pair, *diagonal, *pseudo_erasures;
+
+	phi = talloc(int, (k-1)*(k-1));
+	phi_inv = talloc(int, (k-1)*(k-1));
+	pair = talloc(int, 2);
+	diagonal = talloc(int, 2*(2*k-2));
+	if(phi==NULL||phi_inv==NULL||pair==NULL||diagonal==NULL){
+		printf("Can not allocate memory\n");
+		goto complete;
+	}
+	// the off-diagonal terms: \tilde{S_1}(i,j) = (P(i,j)+P(j,i))/(\lambda_i+\lambda_j) and \tilde{S_2}(i,j) = 
+	// (\lambda_j P(i,j)+\lambda_i P(j,i))/(\lambda_i+\lambda_j). \lambda_i is kept in info->lambda, it is the device ID 
+	// unless the matrix was searched for low density
+	for(i=0;i<k-1;i++){
+		for(j=i+1;j<k-1;j++){
+			inv = galois_single_divide(1,lambda[remaining[i]]^lambda[remaining[j]],w);
+			pair[0] = pair[1] = inv;
+			if(make_plan_encoding(plan, MSR_PLAN_PAIR(i,j,0,k), pair, 2, 1, info)<0)
+				goto complete;
+			pair[0] = galois_single_multiply(lambda[remaining[j]],inv,w);
+			pair[1] = galois_single_multiply(lambda[remaining[i]],inv,w);
+			if(make_plan_encoding(plan, MSR_PLAN_PAIR(i,j,1,k), pair, 2, 1, info)<0)
+				goto complete;
+		}
+	}
+	// compute the A vector: A*\Phi_{DC1} = \Phi_{DC2}, note this is always possible because \Phi_{DC1} is alway full rank by construction
+	for(i=0;i<k-1;i++)
+		memcpy(phi+(k-1)*i,info->matrix+remaining[i]*d+k-1,(k-1)*sizeof(int));
+	if(jerasure_invert_matrix(phi,phi_inv,k-1,w)<0){
+		printf("The remaining devices can not rebuild the data.\n");
+		goto complete;
+	}
+	vector_A = jerasure_matrix_multiply(info->matrix+remaining[k-1]*d+k-1,phi_inv,1,k-1,k-1,k-1,w);
+	if(vector_A==NULL||make_plan_encoding(plan, MSR_PLAN_INVERSE, phi_inv, k-1, k-1, info)<0)
+		goto complete;
+	// the diagonal of column i is decoded from row k-1 of P, i.e., A*\Lambda_{DC2} and A times column i of \tilde{S_1}
+	// and \tilde{S_2}, and from P(i,i) = \lambda_i \tilde{S_1}(i,i) + \tilde{S_2}(i,i), the erasures being the diagonal terms
+	for(i=0;i<k-1;i++){
+		diagonal[i] = galois_single_multiply(vector_A[i],lambda[remaining[k-1]],w);
+		diagonal[i+k-1] = vector_A[i];
+	}
+	for(i=0;i<k-1;i++){
+		memset(diagonal+2*k-2,0,sizeof(int)*(2*k-2));
+		diagonal[2*k-2+i] = lambda[remaining[i]];
+		diagonal[3*k-3+i] = 1;
+		pseudo_erasures = talloc(int, 3);
+		if(pseudo_erasures==NULL){
+			printf("Can not allocate memory\n");
+			goto complete;
+		}
+		plan->erasures_array[MSR_PLAN_DIAGONAL(i)] = pseudo_erasures;
+		pseudo_erasures[0] = i;
+		pseudo_erasures[1] = k-1+i;
+		pseudo_erasures[2] = -1;
+		plan->erased_array[MSR_PLAN_DIAGONAL(i)] = jerasure_erasures_to_erased(2*k-2, 2, pseudo_erasures);
+		if(plan->erased_array[MSR_PLAN_DIAGONAL(i)]==NULL
+			||make_plan_decoding_by_matrix(plan, MSR_PLAN_DIAGONAL(i), diagonal, 2*k-2, 2, pseudo_erasures, info)<0)
+			goto complete;
+	}
+	ret = 1;
+complete:
+	free(phi);
+	free(phi_inv);
+	free(pair);
+	free(diagonal);
+	if(vector_A!=NULL)
+		free(vector_A);
+	return(ret);
+}
+
+int make_decode_plan_MSR_product_matrix(struct decode_plan *plan, struct coding_info *info)
+{
+	int i;
 	int n = info->req.n;
 	int d = info->req.d;
 	int k = info->req.k;
-	int w = info->req.w;
-	int subpacket_size = input_size/(d-k+1);
-	int num_of_long = subpacket_size/sizeof(long);	
-	long *src_pos,*des_pos;
-	int *vector_A=NULL;
- 	char **ptrs;
-	int **decode_schedule=NULL;
-	int *erased = NULL;	
-	int *bitmatrix_temp = malloc(sizeof(int)*(k-1)*(k-1)*w*w*4);
-	char *data_transformed = malloc(input_size*k);    // this is the buffer for tranformed data, i.e., matrix M. The output is the systematic part of 
-							  // codingmatrix*M, and 
-					                  // we will regenerate the erased data from M using the encoding matrix, which will be written to *output.
-	int *pseudo_erasures = malloc(sizeof(int)*(n*2));  // in order to recompute M, we view it as a systematic MDS code, 
-							  // sometimes (n+k,k), sometimes (n+d-k+1,d-k+1), thus we over allocate
-	char **M_ptrs = malloc(sizeof(void*)*d*(d-k+1));  // this is the pointer matrix to elements in M.		
-	char **data_ptrs = malloc(sizeof(void*)*n);
-	char **coding_ptrs = malloc(sizeof(void*)*n);
-	int* remaining = malloc(sizeof(int)*k);           // not erased devices
-	char *buffer1 = malloc(subpacket_size*k*(k-1)*2);  // need subpacketsize*k>=(max(4,k-1)+k-1)*sizeof(int), thus put factor of 2 to guarentee it
-	int *buffer1_int = (int*)buffer1;                  // alternative pointer for buffer1
-	char *buffer2 = malloc(subpacket_size*k*(k-1));
-
-	if(data_transformed==NULL||pseudo_erasures==NULL||data_ptrs==NULL
-		||coding_ptrs==NULL||buffer1==NULL||buffer2==NULL||M_ptrs==NULL||remaining==NULL){
+	int *pseudo_erasures;
+
+	if(info->collapsed_decoding)
+		return(make_collapsed_plan_MSR_product_matrix(plan, info));
+	plan->num_of_schedules = MSR_PLAN_SCHEDULES(k);
+	plan->erasures_array = calloc(plan->num_of_schedules,sizeof(int*));
+	plan->erased_array = calloc(plan->num_of_schedules,sizeof(int*));
+	plan->schedule_array = calloc(plan->num_of_schedules,sizeof(struct jerasure_flat_schedule*));
+	if(plan->erasures_array==NULL||plan->erased_array==NULL||plan->schedule_array==NULL){
 		printf("Can not allocate memory\n");
-		jerasure_free_schedule(decode_schedule);
-		if(data_ptrs!=NULL)free(data_ptrs);
-		if(coding_ptrs!=NULL)free(coding_ptrs);
-		if(pseudo_erasures!=NULL)free(pseudo_erasures);
-		if(data_transformed!=NULL)free(data_transformed);
-		if(M_ptrs!=NULL)free(M_ptrs);	
-		if(buffer1!=NULL)free(buffer1);
-		if(buffer2!=NULL)free(buffer2);
-		if(remaining!=NULL)free(remaining);
 		return(-1);
 	}
-	//set up pointers for matrix M
+	if(make_solve_plan_MSR_product_matrix(plan, info)<0)
+		return(-1);
+	if(d<=2*k-2) // T and Z only exist when d>2k-2
+		return(1);
+
+	// schedule 0 decodes the last d-2k+1 columns of T and Z, viewed as an (n+k,k) MDS code
+	pseudo_erasures = malloc(sizeof(int)*(n+k+1));
+	if(pseudo_erasures==NULL){
+		printf("Can not allocate memory\n");
+		return(-1);
+	}
+	plan->erasures_array[0] = pseudo_erasures;
+	for(i=0;i<k;i++)
+		pseudo_erasures[i] = i;
+	for(i=0;plan->erasures[i]!=-1;i++)
+		pseudo_erasures[i+k] = plan->erasures[i] + k;		
+	pseudo_erasures[i+k] = -1;
+	plan->erased_array[0] = jerasure_erasures_to_erased(k, n, pseudo_erasures);
+	if(make_plan_decoding(plan, 0, 1, pseudo_erasures, info)<0)
+		return(-1);
+
+	// schedule 1 decodes the first column of T and Z, viewed as an (n+d-k+1,d-k+1) erasure code
+	pseudo_erasures = malloc(sizeof(int)*(n+k+1));
+	if(pseudo_erasures==NULL){
+		printf("Can not allocate memory\n");
+		return(-1);
+	}
+	plan->erasures_array[1] = pseudo_erasures;
+	for(i=0;i<k;i++)
+		pseudo_erasures[i] = i; // in the first columne of the Z matrix, the last d-2k+1 elements are known, but the first k elements are not
+	for(i=0;plan->erasures[i]!=-1;i++)
+		pseudo_erasures[i+k] = plan->erasures[i]+d-k+1;		
+	pseudo_erasures[i+k] = -1;
+	plan->erased_array[1] = jerasure_erasures_to_erased(d-k+1, n, pseudo_erasures);
+	if(make_plan_decoding(plan, 1, 2, pseudo_erasures, info)<0)
+		return(-1);
+
+	if(plan->erased_array[0]==NULL||plan->erased_array[1]==NULL){
+		printf("Can not generate decoding schedule.\n");
+		return(-1);
+	}
+	return(1);
+}
+
+// the layout of the message matrix M, d-by-(d-k+1): M_index[i*(d-k+1)+j] is the index of the info symbol at (i,j),
+// the symmetric entries having the same index, or -1 for the zeros. There are k(d-k+1) info symbols.
+static void set_up_message_index(int *M_index, int k, int d)
+{
+	int i, j, c1, c2;
+	int alpha = d-k+1;
+
 	// first k-1 rows, only have S1
 	for(i=0,c2=0;i<k-1;i++){
-		c1 = i*(d-k+1);
+		c1 = i*alpha;
 		for(j=i;j<k-1;j++,c2++)
-			M_ptrs[c1+j] = data_transformed + subpacket_size*c2;
-		for(j=k-1;j<d-k+1;j++)
-			M_ptrs[c1+j] = NULL;			
+			M_index[c1+j] = c2;
+		for(j=k-1;j<alpha;j++)
+			M_index[c1+j] = -1;			
 		for(j=0;j<i;j++)
-			M_ptrs[c1+j] = M_ptrs[j*(d-k+1)+i]; // symmetric matrix, thus there is (i,j) and (j,i) point to the same pointer.
+			M_index[c1+j] = M_index[j*alpha+i]; // symmetric matrix, thus (i,j) and (j,i) are the same symbol
 	}
 	// next k-1 rows
 	for(i=0;i<k-1;i++){
-		c1 = (k-1+i)*(d-k+1);
-		for(j=i;j<d-k+1;j++,c2++)
-			M_ptrs[c1+j] = data_transformed + subpacket_size*c2;
+		c1 = (k-1+i)*alpha;
+		for(j=i;j<alpha;j++,c2++)
+			M_index[c1+j] = c2;
 		for(j=0;j<i;j++)
-			M_ptrs[c1+j] = M_ptrs[(j+k-1)*(d-k+1)+i];		
+			M_index[c1+j] = M_index[(j+k-1)*alpha+i];		
 	}
 	// next 1 and (d-2k+1) rows, may not exist
 	if(d>2*k-2)
 	{
-		c1 = (2*k-2)*(d-k+1);
-		for(j=k-1;j<d-k+1;j++,c2++)
-			M_ptrs[c1+j] = data_transformed + subpacket_size*c2;
-		for(j=0;j<i;j++)
-			M_ptrs[c1+j] = M_ptrs[(j+k-1)*(d-k+1)+k-1];			
+		c1 = (2*k-2)*alpha;
+		for(j=k-1;j<alpha;j++,c2++)
+			M_index[c1+j] = c2;
+		for(j=0;j<k-1;j++)
+			M_index[c1+j] = M_index[(j+k-1)*alpha+k-1];			
 		for(i=2*k-1;i<d;i++){
-			c1 = i*(d-k+1);
+			c1 = i*alpha;
 			for(j=0;j<k;j++)
-				M_ptrs[c1+j] = M_ptrs[(j+k-1)*(d-k+1)+i-k+1];
-			for(j=k;j<d-k+1;j++)
-				M_ptrs[c1+j] = NULL;
+				M_index[c1+j] = M_index[(j+k-1)*alpha+i-k+1];
+			for(j=k;j<alpha;j++)
+				M_index[c1+j] = -1;
 		}
 	}
+}
+
+// the body of decode_MSR_product_matrix_no_output(), see SPECIALIZED_MSR. It decodes bytes [0,length) of every subpacket 
+// in place, subpackets[i*(d-k+1)+j] being subpacket j of device i. The scratch buffers only hold the slab, so they use
+// length as their stride.
+SPECIALIZABLE int decode_MSR_product_matrix_body(char **subpackets, int length, struct decode_plan *plan, int n, int k, int d, int w, struct coding_info *info)
+{
+	int i, j, c1;
+	int *remaining = plan->remaining; // not erased devices
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	int *M_index;
+	char *data_transformed, *buffer1, *buffer2;
+	char **M_ptrs, **data_ptrs, **coding_ptrs, **ptrs;
+
+	if(ws==NULL||(info->backend==BITMATRIX_BACKEND
+		&&(get_bitmatrix(info)==NULL||get_subbitmatrix(info,2)==NULL||get_subbitmatrix(info,3)==NULL)))
+		return(-1);
+	mark = workspace_mark(ws);
+	data_transformed = workspace_alloc(ws, (size_t)length*(d-k+1)*k);	// this is the buffer for tranformed data, i.e., matrix M. The output is the systematic part of 
+								// codingmatrix*M, and 
+								// we will regenerate the erased data from M using the encoding matrix, which will be written to *output.
+	M_ptrs = workspace_alloc(ws, sizeof(void*)*d*(d-k+1));	// this is the pointer matrix to elements in M.		
+	M_index = workspace_alloc(ws, sizeof(int)*d*(d-k+1));
+	data_ptrs = workspace_alloc(ws, sizeof(void*)*n);
+	coding_ptrs = workspace_alloc(ws, sizeof(void*)*n);
+	ptrs = workspace_alloc(ws, sizeof(void*)*(n+d));
+	buffer1 = workspace_alloc(ws, (size_t)length*k*(k-1));
+	buffer2 = workspace_alloc(ws, (size_t)length*k*(k-1));
+
+	if(data_transformed==NULL||data_ptrs==NULL||coding_ptrs==NULL||ptrs==NULL
+		||buffer1==NULL||buffer2==NULL||M_ptrs==NULL||M_index==NULL){
+		printf("Can not allocate memory\n");
+		workspace_release(ws, mark);
+		return(-1);
+	}
+	//set up pointers for matrix M
+	set_up_message_index(M_index, k, d);
+	for(i=0;i<d*(d-k+1);i++)
+		M_ptrs[i] = M_index[i]<0?NULL:data_transformed+(size_t)length*M_index[i];
 	
         // first decode the last d-2k+1 columns of T and Z: view it as an (n+k,k) MDS code. Note strictly speaking this might 
-	// not be a real (n+k,k) MDS code, but it hardly matters.
-	// before decoding operation, prepare for the pseudoerasure location array
+	// not be a real (n+k,k) MDS code, but it hardly matters. The decoding schedules and pseudo erasures are in the plan.
 	if(d>2*k-2){ // only when d>2k-2, T and Z exist
-		for(i=0;i<k;i++)
-			pseudo_erasures[i] = i;
-		for(i=0;i<n;i++){
-			if(erasures[i]==-1){
-				pseudo_erasures[i+k] = -1;
-				break;
-			}
-			pseudo_erasures[i+k] = erasures[i] + k;		
-		}
-
-		// make the decoding schedule: we can save the trouble of manually generate this schedule, at the expense of
-		// more computation
-		decode_schedule = jerasure_generate_decoding_schedule(k, n, w, info->subbitmatrix_array[0], pseudo_erasures, 1);
-
 		for(i=0;i<d-2*k+1;i++){
 			for(j=0;j<k;j++)
 				data_ptrs[j] = M_ptrs[i+k+(d-k+1)*(k-1+j)];		
 			for(j=0;j<n;j++)
-				coding_ptrs[j] = input[j]+subpacket_size*(k+i);
-			ptrs = set_up_ptrs_for_scheduled_decoding(k, n, pseudo_erasures, data_ptrs,coding_ptrs);
-		  	if (ptrs == NULL){
-				printf("Can not allocate memory\n");
-				goto complete;
-			}
+				coding_ptrs[j] = subpackets[j*(d-k+1)+k+i];
 			// assume packetsize = ALIGNMENT
-			for (tdone = 0; tdone < subpacket_size; tdone += ALIGNMENT*w) {
-				jerasure_do_scheduled_operations(ptrs, decode_schedule, ALIGNMENT);
-				for (c1 = 0; c1 < k+n; c1++) ptrs[c1] += (ALIGNMENT*w);
-			}
-			free(ptrs);
+			decode_by_plan(plan, 0, k, n, data_ptrs, coding_ptrs, ptrs, length, info);
 		} 
 		//next decode the first column of T and Z: we view this as an (n+d-k+1,d-k+1) erasure codes
-		// first setup the pseudo erasure location vector	
-		for(i=0;i<k;i++)
-			pseudo_erasures[i] = i; // in the first columne of the Z matrix, the last d-2k+1 elements are known, but the first k elements are not
-		for(i=0;i<n;i++)
-		{
-			if(erasures[i]==-1){
-				pseudo_erasures[i+k] = -1;
-				break;
-			}
-			pseudo_erasures[i+k] = erasures[i]+d-k+1;		
-		}
 		for(j=0;j<d-k+1;j++)
 			data_ptrs[j] = M_ptrs[(d-k+1)*(k-1+j)+k-1];
 		for(j=0;j<n;j++)
-			coding_ptrs[j] = input[j]+subpacket_size*(k-1);
-		jerasure_schedule_decode_lazy(d-k+1,n,w,
-					info->subbitmatrix_array[1],pseudo_erasures,data_ptrs,
-					coding_ptrs,subpacket_size,ALIGNMENT,0);
+			coding_ptrs[j] = subpackets[j*(d-k+1)+k-1];
+		decode_by_plan(plan,1,d-k+1,n,data_ptrs,coding_ptrs,ptrs,length,info);
 	}
 	//clk = clock();
 
 	// now this is the hard part: to decode S1 and S2. The algorithm used here is slightly different from that in the paper:
 	// instead of right multiply \Phi_{DC}', we only right multiply the sub-matrix of \Phi_{DC}' without of the last row
 
-	// setting up remaining device array to facilitate decoding
-	erased = jerasure_erasures_to_erased(k, n-k, erasures);
-	for(i=0,c1=0;i<n&&c1<k;i++){
-		if(erased[i]==0){
-			remaining[c1] = i;
-			c1++;
-		}	
-	}	
 	//compute C_{DC}-\Delta_{DC}*T'
 	for(i=0;i<k-1;i++){ // has k-1 columns
 		for(j=0;j<d-2*k+2;j++)
 			data_ptrs[j] = M_ptrs[(2*k-2+j)*(d-k+1)+i];
-		for(j=0;j<k;j++)
-			coding_ptrs[j] = buffer1+(j*(k-1)+i)*subpacket_size;
 		for(j=0;j<k;j++){
-			jerasure_bitmatrix_dotprod(d-2*k+2, w, info->subbitmatrix_array[2]+remaining[j]*(d-2*k+2)*w*w, NULL, j+d-2*k+2,
-        	                data_ptrs, coding_ptrs, subpacket_size, ALIGNMENT);
-			src_pos = (long*)(input[remaining[j]]+i*subpacket_size);
-			des_pos	= (long*)(coding_ptrs[j]);
-			for(c2=0;c2<num_of_long;c2++)	
-				des_pos[c2] ^= src_pos[c2];
-		}	
+			coding_ptrs[j] = buffer1+(j*(k-1)+i)*length;
+			memcpy(coding_ptrs[j],subpackets[remaining[j]*(d-k+1)+i],length);
+		}
+		// all the k rows of \Delta_{DC} in one pass over T'
+		dotprod_rows_by_matrix(3, remaining, k, data_ptrs, coding_ptrs, length, 1, info);
 	}
 	
 	// right multiply \Phi_{DC}': this will be P. 
 	// result is in buffer2
 	for(j=0;j<k;j++){ //j-th row
 		for(i=0;i<k-1;i++)
-			data_ptrs[i] = buffer1+(j*(k-1)+i)*subpacket_size;
+			data_ptrs[i] = buffer1+(j*(k-1)+i)*length;
 		for(i=0;i<k-1;i++)
-			coding_ptrs[i] = buffer2 +(j*(k-1)+i)*subpacket_size;
-		for(i=0;i<k-1;i++){
-			jerasure_bitmatrix_dotprod(k-1, w, info->subbitmatrix_array[3]+remaining[i]*(k-1)*w*w, NULL, i+k-1,
-        	                data_ptrs, coding_ptrs, subpacket_size, ALIGNMENT);
-		}
+			coding_ptrs[i] = buffer2 +(j*(k-1)+i)*length;
+		dotprod_rows_by_matrix(4, remaining, k-1, data_ptrs, coding_ptrs, length, 0, info);
 	}
-	// now solve for the off-diagonal terms
+	// now solve for the off-diagonal terms, with the schedules of the plan
 	for(i=0;i<k-1;i++){
 		for(j=i+1;j<k-1;j++){
+			data_ptrs[0] = buffer2+(i*(k-1)+j)*length;
+			data_ptrs[1] = buffer2+(j*(k-1)+i)*length;
 			// solve for S1 tilde off-diagonal 
-			// here we directly use the fact that Lambda = [0 1 2 3 ....];	
-			int** temp_schedule;			
-			inv = galois_single_divide(1,remaining[i]^remaining[j],w);					
-			buffer1_int[0] = buffer1_int[1] = inv;			
-			data_ptrs[0] = buffer2+(i*(k-1)+j)*subpacket_size;
-			data_ptrs[1] = buffer2+(j*(k-1)+i)*subpacket_size;
 			coding_ptrs[0] = M_ptrs[i*(d-k+1)+j];
-			jerasure_matrix_to_bitmatrix_noallocate(2,1,w,buffer1_int,bitmatrix_temp);
-			temp_schedule = jerasure_smart_bitmatrix_to_schedule(2, 1, w, bitmatrix_temp);
-			jerasure_schedule_encode(2, 1, w, temp_schedule, data_ptrs, coding_ptrs,subpacket_size, ALIGNMENT);	
-			if(temp_schedule!=NULL){
-				jerasure_free_schedule(temp_schedule);
-				temp_schedule = NULL;
-			}			
+			encode_by_plan(plan, MSR_PLAN_PAIR(i,j,0,k), 2, 1, data_ptrs, coding_ptrs, ptrs, length, info);
 			// solve for S2 tilde off-diagonal
-			buffer1_int[0] = galois_single_multiply(remaining[j],inv,w);
-			buffer1_int[1] = galois_single_multiply(remaining[i],inv,w);
 			coding_ptrs[0] = M_ptrs[(i+k-1)*(d-k+1)+j];
-			jerasure_matrix_to_bitmatrix_noallocate(2,1,w,buffer1_int,bitmatrix_temp);
-			temp_schedule = jerasure_smart_bitmatrix_to_schedule(2, 1, w, bitmatrix_temp);
-			jerasure_schedule_encode(2, 1, w, temp_schedule, data_ptrs, coding_ptrs,subpacket_size, ALIGNMENT);	
-			if(temp_schedule!=NULL){
-				jerasure_free_schedule(temp_schedule);
-				temp_schedule = NULL;
-			}			
+			encode_by_plan(plan, MSR_PLAN_PAIR(i,j,1,k), 2, 1, data_ptrs, coding_ptrs, ptrs, length, info);
 		}	
 	}
-	//tclk = clock()-clk;
-	//printf("~S1 and ~S2 off-diagonal decoded %.3e clocks \n", (double)tclk);	
-	//clk = clock();
-	// compute the A vector: A*\Phi_{DC1} = \Phi_{DC2}, note this is always possible because \Phi_{DC1} is alway full rank by construction
-	// we first reuse buffer1 here to form \Phi_{DC1} matrix and then the compute its inverse
-	for(i=0;i<k-1;i++){
-		memcpy(buffer1_int+(k-1)*(k-1+i),(void*)(info->matrix+remaining[i]*d+k-1),(k-1)*sizeof(int));
-	}
-
-	jerasure_invert_matrix(buffer1_int+(k-1)*(k-1),buffer1_int,k-1,w);	
-	vector_A = jerasure_matrix_multiply(info->matrix+remaining[k-1]*d+k-1,buffer1_int,1,k-1,k-1,k-1,w);	
-	if(vector_A==NULL)
-		goto complete;	
-	
+	// then the diagonal terms, from the last row of P and the diagonal of P, see make_solve_plan_MSR_product_matrix()
 	for(i=0;i<k-1;i++){
-		buffer1_int[i+(k-1)*(k-1)] = galois_single_multiply(vector_A[i],remaining[k-1],w);		
-		buffer1_int[i+k*(k-1)] = vector_A[i];
-	}		
-
-	for(i=0;i<k-1;i++){
-		memset(buffer1_int+(k-1)*(k+1),0,sizeof(int)*2*(k-1));
-		buffer1_int[(k-1)*(k+1)+i] = remaining[i];
-		buffer1_int[(k-1)*(k+2)+i] = 1;
-
-		pseudo_erasures[0] = i;
-		pseudo_erasures[1] = k-1+i;
-		pseudo_erasures[2] = -1;
 		for(j=0;j<2*k-2;j++)
 			data_ptrs[j] = M_ptrs[i+j*(d-k+1)];
-		coding_ptrs[0] = buffer2+((k-1)*(k-1)+i)*subpacket_size;
-		coding_ptrs[1] = buffer2+(i*(k-1)+i)*subpacket_size;
-
-		jerasure_matrix_to_bitmatrix_noallocate(2*k-2,2,w,buffer1_int+(k-1)*(k-1),bitmatrix_temp);				
-		jerasure_schedule_decode_lazy(2*k-2,2,w,bitmatrix_temp,pseudo_erasures,data_ptrs,coding_ptrs,subpacket_size,ALIGNMENT,0);
-      	}
-	//tclk = clock()-clk;
-	//printf("~S1 and ~S2 decoded %.3e clocks \n", (double)tclk);	
+		coding_ptrs[0] = buffer2+((k-1)*(k-1)+i)*length;
+		coding_ptrs[1] = buffer2+(i*(k-1)+i)*length;
+		decode_by_plan(plan, MSR_PLAN_DIAGONAL(i), 2*k-2, 2, data_ptrs, coding_ptrs, ptrs, length, info);
+	}
 	// now we have both \tilde{S_1} and \tilde{S_2} in M_ptrs, need to recover S1 and S2 from them
 	// this is done by multiply \tilde{S_1} left and right by inv(\Phi_{DC1}).
-	// right-multiply for S1 
-	int* bitmatrix_inv = jerasure_matrix_to_bitmatrix(k-1,k-1,w,buffer1_int);
-	int** inv_schedule = jerasure_smart_bitmatrix_to_schedule(k-1, k-1, w, bitmatrix_inv);
-
 	// right-multiply for S1
 	for(i=0;i<k-1;i++){
 		for(j=0;j<k-1;j++)
 			data_ptrs[j] = M_ptrs[i*(d-k+1)+j];		
 		for(j=0;j<k-1;j++)
-			coding_ptrs[j] = buffer2+(i*(k-1)+j)*subpacket_size;	
-		jerasure_schedule_encode(k-1, k-1, w, inv_schedule, data_ptrs, coding_ptrs, subpacket_size, ALIGNMENT);	
+			coding_ptrs[j] = buffer2+(i*(k-1)+j)*length;	
+		encode_by_plan(plan, MSR_PLAN_INVERSE, k-1, k-1, data_ptrs, coding_ptrs, ptrs, length, info);
 	}
 	// left-multiply for S1 
 	for(j=0;j<k-1;j++){
 		for(i=0;i<k-1;i++)
-			data_ptrs[i] = buffer2+(i*(k-1)+j)*subpacket_size;
+			data_ptrs[i] = buffer2+(i*(k-1)+j)*length;
 		for(i=0;i<k-1;i++)
 			coding_ptrs[i] = M_ptrs[i*(d-k+1)+j];
-
-		jerasure_schedule_encode(k-1, k-1, w, inv_schedule, data_ptrs, coding_ptrs, subpacket_size, ALIGNMENT);
-
+		encode_by_plan(plan, MSR_PLAN_INVERSE, k-1, k-1, data_ptrs, coding_ptrs, ptrs, length, info);
 	}
 	// right-multiply for S2
 	for(i=0;i<k-1;i++){
 		for(j=0;j<k-1;j++)
 			data_ptrs[j] = M_ptrs[(i+k-1)*(d-k+1)+j];
 		for(j=0;j<k-1;j++)
-			coding_ptrs[j] = buffer2+(i*(k-1)+j)*subpacket_size;
-
-		jerasure_schedule_encode(k-1, k-1, w, inv_schedule, data_ptrs, coding_ptrs, subpacket_size, ALIGNMENT);
+			coding_ptrs[j] = buffer2+(i*(k-1)+j)*length;
+		encode_by_plan(plan, MSR_PLAN_INVERSE, k-1, k-1, data_ptrs, coding_ptrs, ptrs, length, info);
 	}
 	// left-multiply for S2 
 	for(j=0;j<k-1;j++){
 		for(i=0;i<k-1;i++)
-			data_ptrs[i] = buffer2+(i*(k-1)+j)*subpacket_size;
-		//for(i=j;i<k-1;i++)
+			data_ptrs[i] = buffer2+(i*(k-1)+j)*length;
 		for(i=0;i<k-1;i++)
 			coding_ptrs[i] = M_ptrs[(i+k-1)*(d-k+1)+j];
-
-		jerasure_schedule_encode(k-1, k-1, w, inv_schedule, data_ptrs, coding_ptrs, subpacket_size, ALIGNMENT);
+		encode_by_plan(plan, MSR_PLAN_INVERSE, k-1, k-1, data_ptrs, coding_ptrs, ptrs, length, info);
 	}
-	// having S1,S2,T, now can also fill the first k-1 column of the output		
+	// having S1,S2,T, now can also fill the first k-1 column of the output, all the erased rows in one pass
+	for(c1=0;plan->erasures[c1]!=-1;c1++);
 	for(i=0;i<k-1;i++){
 		for(j=0;j<d;j++)
 			data_ptrs[j] = M_ptrs[j*(d-k+1)+i];
-		for(j=0;j<n;j++)
-			coding_ptrs[j] = input[j]+i*subpacket_size;
-		for(j=0;j<n;j++){
-			if(erased[j]==1)
-				jerasure_bitmatrix_encode(d,1,w,info->bitmatrix+(j*d*w*w),data_ptrs,coding_ptrs+j,subpacket_size,ALIGNMENT);
-		}
+		for(j=0;j<c1;j++)
+			coding_ptrs[j] = subpackets[plan->erasures[j]*(d-k+1)+i];
+		dotprod_rows_by_matrix(0, plan->erasures, c1, data_ptrs, coding_ptrs, length, 0, info);
 	}
 
-	// clean up
-complete:
-	if(decode_schedule)
-		jerasure_free_schedule(decode_schedule);
-	if(inv_schedule)
-		jerasure_free_schedule(inv_schedule);
-	free(data_ptrs);
-	free(coding_ptrs);
-	if(erased)free(erased);
-	free(pseudo_erasures);
-	free(data_transformed);
-	free(M_ptrs);	
-	free(buffer1);
-	free(buffer2);
-	free(remaining);
-	free(bitmatrix_temp);
-	if(vector_A!=NULL)free(vector_A);
+	workspace_release(ws, mark);
 	return(1);
 }
 
+#define DECODE_MSR_SPECIALIZED(N,K,D,W) \
+	if(n==N&&k==K&&d==D&&w==W) \
+		return(decode_MSR_product_matrix_body(subpackets, length, plan, N, K, D, W, info));
+
+static int decode_MSR_product_matrix_tile(char **subpackets, int length, struct decode_plan *plan, struct coding_info *info)
+{
+	int n = info->req.n;
+	int k = info->req.k;
+	int d = info->req.d;
+	int w = info->req.w;
+	SPECIALIZED_MSR(DECODE_MSR_SPECIALIZED)
+	return(decode_MSR_product_matrix_body(subpackets, length, plan, n, k, d, w, info));
+}
+
+// bytes a decoding touches per byte of subpacket: the subpackets of the devices, and its scratch, M and the two buffers
+#define MSR_DECODE_SCRATCH_PER_BYTE(k,d) ((k)*((d)-(k)+1)+2*(k)*((k)-1))
+#define MSR_DECODE_BYTES_PER_BYTE(n,k,d) ((n)*((d)-(k)+1)+MSR_DECODE_SCRATCH_PER_BYTE(k,d))
+
+// runs all the phases of the decoding on one tile of the subpackets at a time, see set_tile_bytes(). The tiles also
+// keep the scratch within the memory budget, see set_memory_budget(). input[i] of an erased parity device can be NULL,
+// e.g., in a read-only decoding: the device is then rebuilt a tile at a time in scratch, and thrown away.
+int decode_MSR_product_matrix_no_output(char **input, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info)
+{
+	int i, j, s, offset, tile, ret = 1;
+	int n = info->req.n;
+	int k = info->req.k;
+	int d = info->req.d;
+	int alpha = d-k+1;
+	int num_of_scratch = 0;
+	struct workspace *ws;
+	size_t mark;
+	char **tile_ptrs, *scratch;
+
+	for(i=0;i<n;i++){
+		if(input[i]!=NULL)
+			continue;
+		if(plan->erased[i]==0||i<k){
+			printf("Only erased parity devices can be left out.\n");
+			return(-1);
+		}
+		num_of_scratch++;
+	}
+	tile = get_tile_length(info, length, MSR_DECODE_BYTES_PER_BYTE(n,k,d), MSR_DECODE_SCRATCH_PER_BYTE(k,d)+num_of_scratch*alpha);
+	if(tile==0&&length>0)
+		return(-1);
+	ws = get_workspace(info);
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	tile_ptrs = workspace_alloc(ws, sizeof(char*)*n*alpha);
+	scratch = workspace_alloc(ws, (size_t)num_of_scratch*alpha*tile);
+	if(tile_ptrs==NULL||(scratch==NULL&&num_of_scratch>0)){
+		printf("Can not allocate memory\n");
+		workspace_release(ws, mark);
+		return(-1);
+	}
+	for(offset=0;offset<length&&ret>0;offset+=tile){
+		for(i=0,s=0;i<n;i++){
+			for(j=0;j<alpha;j++)
+				tile_ptrs[i*alpha+j] = input[i]!=NULL?input[i]+(size_t)j*subpacket_size+offset:scratch+((size_t)s*alpha+j)*tile;
+			if(input[i]==NULL)
+				s++;
+		}
+		ret = decode_MSR_product_matrix_tile(tile_ptrs, MIN(tile,length-offset), plan, info);
+	}
+	workspace_release(ws, mark);
+	return(ret);
+}
+
 int decode_MSR_product_matrix(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info)
 {
-	int i;
+	int ret;
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	if(plan==NULL)
+		return(-1);
+	ret = decode_MSR_product_matrix_with_plan(input, input_size, output, output_size, plan, info);
+	free_decode_plan(plan);
+	return(ret);
+}
+
+int decode_MSR_product_matrix_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info)
+{
+	int subpacket_size = input_size/(info->req.d-info->req.k+1);
+	return(decode_rc_region(input, output, subpacket_size, subpacket_size, plan, info));
+}
+
+// decodes with the collapsed map of the plan: the erased data subpackets are written straight to output, in one pass
+// over the remaining devices
+static int decode_MSR_product_matrix_collapsed(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info)
+{
+	int i,j,e;
 	int k = info->req.k;
-	if(decode_MSR_product_matrix_no_output(input, input_size, erasures, info)<0)
+	int alpha = info->req.d-k+1;
+	int cols = plan->collapsed_cols;
+	int rows = plan->collapsed_rows;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_ptrs, **coding_ptrs, **ptrs;
+
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	data_ptrs = workspace_alloc(ws, sizeof(char*)*cols);
+	coding_ptrs = workspace_alloc(ws, sizeof(char*)*(rows+1));
+	ptrs = workspace_alloc(ws, sizeof(char*)*(cols+rows+1));
+	if(data_ptrs==NULL||coding_ptrs==NULL||ptrs==NULL){
+		printf("Can not allocate memory\n");
+		workspace_release(ws, mark);
 		return(-1);
-	for(i=0;i<k;i++,output+=input_size)
-		memcpy(output,input[i],input_size);
+	}
+	for(i=0;i<k;i++)
+		for(j=0;j<alpha;j++)
+			data_ptrs[i*alpha+j] = input[plan->remaining[i]]+j*subpacket_size;
+	for(i=0,e=0;plan->erasures[i]!=-1;i++){
+		if(plan->erasures[i]>=k)
+			continue;
+		for(j=0;j<alpha;j++){
+			if(output[alpha*plan->erasures[i]+j]==NULL)
+				output[alpha*plan->erasures[i]+j] = input[plan->erasures[i]]+j*subpacket_size;
+			coding_ptrs[e*alpha+j] = output[alpha*plan->erasures[i]+j];
+		}
+		e++;
+	}
+	if(decode_by_collapsed_plan(plan, data_ptrs, coding_ptrs, ptrs, length, info)<0){
+		workspace_release(ws, mark);
+		return(-1);
+	}
+	workspace_release(ws, mark);
+	for(i=0;i<k;i++)
+		if(plan->erased[i]==0)
+			for(j=0;j<alpha;j++)
+				place_region(&output[alpha*i+j], input[i]+j*subpacket_size, length);
 	return(1);
 }
 
-int repair_encode_MSR_product_matrix(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info)
+int decode_MSR_product_matrix_iov(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info)
 {
+	int i,j;
 	int d = info->req.d;
 	int k = info->req.k;
-	int w = info->req.w;
-	int subpacket_size = input_size/(d-k+1);	
-	int i;
+	if(plan->collapsed_cols>0)
+		return(decode_MSR_product_matrix_collapsed(input, output, subpacket_size, length, plan, info));
+	if(decode_MSR_product_matrix_no_output(input, subpacket_size, length, plan, info)<0)
+		return(-1);
+	for(i=0;i<k;i++)
+		for(j=0;j<d-k+1;j++)
+			place_region(&output[(d-k+1)*i+j], input[i]+j*subpacket_size, length);
+	return(1);
+}
+
+int repair_encode_MSR_product_matrix(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info)
+{
+	int subpacket_size = input_size/(info->req.d-info->req.k+1);	
 	if(subpacket_size!=output_size){
 		printf("Incorrect buffer size.\n");
 		return(-1);
 	}
-	char** data_ptrs = malloc(sizeof(void*)*d);
-	if(data_ptrs==NULL)
+	return(repair_encode_MSR_product_matrix_region(input, output, subpacket_size, subpacket_size, from_device_ID, to_device_ID, info));
+}
+
+int repair_encode_MSR_product_matrix_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info)
+{
+	int d = info->req.d;
+	int k = info->req.k;
+	int i;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char** data_ptrs;
+	if(ws==NULL||(info->backend==BITMATRIX_BACKEND&&get_subbitmatrix(info,1)==NULL))
+		return(-1);
+	mark = workspace_mark(ws);
+	data_ptrs = workspace_alloc(ws, sizeof(void*)*d);
+	if(data_ptrs==NULL){
+		workspace_release(ws, mark);
 		return(-1);
+	}
 	
 	for(i=0;i<d-k+1;i++)
 		data_ptrs[i] = input+i*subpacket_size;
-	jerasure_bitmatrix_encode(d-k+1,1,w,info->subbitmatrix_array[1]+(d-k+1)*w*to_device_ID*w,data_ptrs,(char**)(&output),subpacket_size,ALIGNMENT);
+	dotprod_by_matrix(2,to_device_ID,data_ptrs,output,length,info);
 	
-	free(data_ptrs);	
+	workspace_release(ws, mark);
 	return(1);
 }
-int repair_decode_MSR_product_matrix(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info)
+// builds the repair coefficients for the newcomer entry->to_device_ID from the helpers entry->helpers
+static int make_repair_entry_MSR_product_matrix(struct repair_entry *entry, struct coding_info *info)
 {
-	int i,counter;
+	int i;
 	int d = info->req.d;	
 	int k = info->req.k;
 	int w = info->req.w;
-	int subpacket_size = input_size;
-	char** coding_ptrs = malloc(sizeof(void*)*(d-k+1));
 	int *repair_matrix = malloc(sizeof(int)*d*d);
 	int *repair_matrix_inv = malloc(sizeof(int)*d*d);
 	int *combination_matrix = malloc(sizeof(int)*(d-k+1)*d);
+	int *coding_matrix = NULL;
 
-	for(i=0,counter=0;i<d&&helpers[i]>=0;i++,counter++)
-		memcpy(repair_matrix+d*i,info->matrix+d*helpers[i],sizeof(int)*d);
-	if(counter<d){
-		printf("Insufficient number of helpers.\n");
+	if(repair_matrix==NULL||repair_matrix_inv==NULL||combination_matrix==NULL){
+		printf("Can not allocate memory\n");
+		free(repair_matrix);
+		free(repair_matrix_inv);
+		free(combination_matrix);
+		return(-1);
+	}
+	for(i=0;i<d;i++)
+		memcpy(repair_matrix+d*i,info->matrix+d*entry->helpers[i],sizeof(int)*d);
+	if(jerasure_invert_matrix(repair_matrix,repair_matrix_inv,d,w)<0){
+		printf("The helpers can not repair the failed device.\n");
+		free(repair_matrix);
+		free(repair_matrix_inv);
+		free(combination_matrix);
 		return(-1);
 	}
-	jerasure_invert_matrix(repair_matrix,repair_matrix_inv,d,w);
 	memset(combination_matrix,0,sizeof(int)*(d-k+1)*d);
 	for(i=0;i<k-1;i++){
-		*(combination_matrix+(d*i)+i) = to_device_ID;
+		*(combination_matrix+(d*i)+i) = info->lambda[entry->to_device_ID];
 		*(combination_matrix+(d*i)+i+k-1) = 1;
 	}
 	for(i=k-1;i<d-k+1;i++)
 		*(combination_matrix+(d*i)+i+k-1) = 1;
 
-	int *coding_matrix = jerasure_matrix_multiply(combination_matrix,repair_matrix_inv,d-k+1,d,d,d,w);
-		
-	for(i=0; i<d-k+1 ;i++)
-		coding_ptrs[i] = output + i*subpacket_size;
-	int *coding_bitmatrix = jerasure_matrix_to_bitmatrix(d,d-k+1,w,coding_matrix);
-	jerasure_bitmatrix_encode(d,d-k+1,w,coding_bitmatrix,(char**)input,coding_ptrs,subpacket_size,ALIGNMENT);
+	coding_matrix = jerasure_matrix_multiply(combination_matrix,repair_matrix_inv,d-k+1,d,d,d,w);
+	entry->matrix = coding_matrix;
+	if(coding_matrix!=NULL&&info->backend==BITMATRIX_BACKEND){
+		entry->bitmatrix = jerasure_matrix_to_bitmatrix(d,d-k+1,w,coding_matrix);
+		entry->schedule = jerasure_smart_bitmatrix_to_schedule(d,d-k+1,w,entry->bitmatrix);
+	}
 
-	free(coding_ptrs);
-	free(coding_matrix);
 	free(repair_matrix);
 	free(repair_matrix_inv);
 	free(combination_matrix);
-	free(coding_bitmatrix);
+	return(coding_matrix==NULL?-1:1);
+}
+
+int repair_decode_MSR_product_matrix(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info)
+{
+	int i,counter;
+	int d = info->req.d;	
+
+	for(i=0,counter=0;i<d&&helpers[i]>=0;i++,counter++);
+	if(counter<d){
+		printf("Insufficient number of helpers.\n");
+		return(-1);
+	}
+	return(repair_decode_MSR_product_matrix_region(input, output, input_size, input_size, to_device_ID, helpers, info));
+}
+
+int repair_decode_MSR_product_matrix_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info)
+{
+	int i;
+	int d = info->req.d;	
+	int k = info->req.k;
+	char **coding_ptrs, **ptrs;
+	struct repair_entry *entry;
+	struct workspace *ws;
+	size_t mark;
+
+	ws = get_workspace(info);
+	if(ws==NULL)
+		return(-1);
+	entry = get_repair_entry(to_device_ID, helpers, info, make_repair_entry_MSR_product_matrix);
+	if(entry==NULL)
+		return(-1);
+
+	mark = workspace_mark(ws);
+	coding_ptrs = workspace_alloc(ws, sizeof(void*)*(d-k+1));
+	ptrs = workspace_alloc(ws, sizeof(void*)*(2*d-k+1));
+	if(coding_ptrs==NULL||ptrs==NULL){
+		printf("Can not allocate memory\n");
+		put_repair_entry(entry, info);
+		workspace_release(ws, mark);
+		return(-1);
+	}
+	for(i=0; i<d-k+1 ;i++)
+		coding_ptrs[i] = output + i*subpacket_size;
+	encode_by_entry(entry,d,d-k+1,(char**)input,coding_ptrs,ptrs,length,info);
+
+	put_repair_entry(entry, info);
+	workspace_release(ws, mark);
+	return(1);
+}
+
+// row x of the encoding matrix, i.e., the row with the evaluation point \lambda = x and \Phi = [1 x^2 x^4 ...],
+// \Delta continuing the powers of x. The columns are a permutation of [1 x x^2 ... x^(d-1)], hence any d rows with
+// distinct points are a Vandermonde matrix with permuted columns and any k-1 rows of \Phi are invertible too
+void make_MSR_product_matrix_row(int x, int *row, int k, int d, int w)
+{
+	int j;
+	int beta = galois_single_multiply(x,x,w);
+
+	// THE \Lambda\Phi part
+	row[0] = x;
+	for(j=1;j<k-1;j++)
+		row[j] = galois_single_multiply(row[j-1],beta,w);
+	// the \Phi part with the first column of \Delta, which is only there when d>2k-2
+	row[k-1] = 1;
+	for(j=k;j<2*k-1&&j<d;j++)
+		row[j] = galois_single_multiply(row[j-1],beta,w);
+	// the \Delta part without the first column
+	for(j=2*k-1;j<d;j++)
+		row[j] = galois_single_multiply(row[j-1],x,w);
+}
+
+// the columns j and k-1+j of [\Lambda\Phi, \Phi] share a scale so that \lambda_i stays the ratio of columns 0 and k-1
+// of row i, each column of \Delta has its own
+#define MSR_SCALE_GROUP(j,k) ((j)<2*(k)-2?(j)%((k)-1):(j))
+#define MSR_SEARCH_ROUNDS 8
+#define MSR_SEARCH_POINTS 256
+
+// row x scaled by the column scales, returns the best scale of the row and its number of ones in *cost
+static int scale_MSR_product_matrix_row(int x, int scale, int *col_scales, int *row, int *ones, int *cost, int k, int d, int w)
+{
+	int j;
+
+	make_MSR_product_matrix_row(x,row,k,d,w);
+	for(j=0;j<d;j++)
+		row[j] = galois_single_multiply(row[j],col_scales[MSR_SCALE_GROUP(j,k)],w);
+	return(jerasure_best_scale(row,d,w,ones,scale,cost));
+}
+
+// searches the encoding matrix with the fewest ones in its bitmatrix: the evaluation points of the rows are taken
+// among the first MSR_SEARCH_POINTS field elements, and the rows and the scale groups of columns are scaled, which
+// keeps the form [\Lambda\Phi, \Phi, \Delta] with \lambda_i = x_i. It starts from the points 0,1,...,n-1, so the result
+// never has more ones than the default matrix. Returns -1 if the field is too large to search.
+int search_MSR_product_matrix(int *matrix, struct coding_info *info)
+{
+	int n = info->req.n;
+	int k = info->req.k;
+	int d = info->req.d;
+	int w = info->req.w;
+	int pool = MIN(1<<w,MSR_SEARCH_POINTS);
+	int *ones, *points, *used, *row_scales, *col_scales, *row, *elts;
+	int i,j,g,x,num,round,improved,scale,cost,best_x,best_scale,best_cost;
+
+	ones = jerasure_make_ones_table(w);
+	if(ones==NULL)
+		return(-1);
+	points = talloc(int, n);
+	row_scales = talloc(int, n);
+	used = talloc(int, pool);
+	col_scales = talloc(int, d);
+	row = talloc(int, d);
+	elts = talloc(int, 2*n);
+	if(points==NULL||row_scales==NULL||used==NULL||col_scales==NULL||row==NULL||elts==NULL){
+		printf("Can not allocate memory.\n");
+		free(ones); free(points); free(row_scales); free(used); free(col_scales); free(row); free(elts);
+		return(-1);
+	}
+	memset(used,0,sizeof(int)*pool);
+	for(i=0;i<n;i++){
+		points[i] = i;
+		row_scales[i] = 1;
+		used[i] = 1;
+	}
+	for(j=0;j<d;j++)
+		col_scales[j] = 1;
+
+	for(round=0,improved=1;round<MSR_SEARCH_ROUNDS&&improved;round++){
+		improved = 0;
+		// the point and the scale of each row, a new point has to be strictly better
+		for(i=0;i<n;i++){
+			best_x = points[i];
+			best_scale = scale_MSR_product_matrix_row(points[i],row_scales[i],col_scales,row,ones,&best_cost,k,d,w);
+			for(x=0;x<pool;x++){
+				if(used[x])
+					continue;
+				scale = scale_MSR_product_matrix_row(x,1,col_scales,row,ones,&cost,k,d,w);
+				if(cost<best_cost){
+					best_x = x;
+					best_scale = scale;
+					best_cost = cost;
+				}
+			}
+			if(best_x!=points[i]||best_scale!=row_scales[i])
+				improved = 1;
+			used[points[i]] = 0;
+			used[best_x] = 1;
+			points[i] = best_x;
+			row_scales[i] = best_scale;
+		}
+		// the scale of each group of columns, the matrix holds the rows without the column scales
+		for(i=0;i<n;i++){
+			make_MSR_product_matrix_row(points[i],matrix+i*d,k,d,w);
+			for(j=0;j<d;j++)
+				matrix[i*d+j] = galois_single_multiply(matrix[i*d+j],row_scales[i],w);
+		}
+		for(g=0;g<d;g++){
+			if(g>=k-1&&g<2*k-2)
+				continue;
+			for(i=0,num=0;i<n;i++){
+				elts[num++] = matrix[i*d+g];
+				if(g<k-1)
+					elts[num++] = matrix[i*d+k-1+g];
+			}
+			scale = jerasure_best_scale(elts,num,w,ones,col_scales[g],&cost);
+			if(scale!=col_scales[g])
+				improved = 1;
+			col_scales[g] = scale;
+		}
+	}
+
+	for(i=0;i<n;i++){
+		make_MSR_product_matrix_row(points[i],matrix+i*d,k,d,w);
+		for(j=0;j<d;j++)
+			matrix[i*d+j] = galois_single_multiply(galois_single_multiply(matrix[i*d+j],row_scales[i],w),
+				col_scales[MSR_SCALE_GROUP(j,k)],w);
+	}
+	free(ones); free(points); free(row_scales); free(used); free(col_scales); free(row); free(elts);
 	return(1);
 }
+
+// E, the coded subpackets as a linear function of the info symbols of M: row i*(d-k+1)+j is subpacket j of device i, 
+// i.e., row i of the encoding matrix times column j of M
+static int* make_MSR_symbol_matrix(struct coding_info *info)
+{
+	int i, j, r, x;
+	int n = info->req.n;
+	int k = info->req.k;
+	int d = info->req.d;
+	int alpha = d-k+1;
+	int symbols = k*alpha;
+	int *M_index, *E;
+
+	M_index = talloc(int, d*alpha);
+	E = calloc((size_t)n*alpha*symbols,sizeof(int));
+	if(M_index==NULL||E==NULL){
+		printf("Can not allocate memory\n");
+		free(M_index);
+		free(E);
+		return(NULL);
+	}
+	set_up_message_index(M_index, k, d);
+	for(i=0;i<n;i++){
+		for(j=0;j<alpha;j++){
+			for(r=0;r<d;r++){
+				x = M_index[r*alpha+j];
+				if(x>=0)
+					E[(i*alpha+j)*symbols+x] ^= info->matrix[i*d+r];
+			}
+		}
+	}
+	free(M_index);
+	return(E);
+}
+
+// the systematic generator: row (i-k)*(d-k+1)+j gives subpacket j of parity device i from the k(d-k+1) subpackets of 
+// the systematic devices, subpacket j of device i being column i*(d-k+1)+j. Device i stores row i of the encoding 
+// matrix times M, a linear function E of the info symbols of M, so the generator is E_parity * E_systematic^-1, 
+// E_systematic being invertible because any k devices can rebuild the data.
+int* make_MSR_systematic_generator(struct coding_info *info)
+{
+	int n = info->req.n;
+	int k = info->req.k;
+	int w = info->req.w;
+	int alpha = info->req.d-k+1;
+	int symbols = k*alpha;
+	int *E, *inverse, *generator = NULL;
+
+	E = make_MSR_symbol_matrix(info);
+	inverse = talloc(int, symbols*symbols);
+	if(E==NULL||inverse==NULL){
+		printf("Can not allocate memory\n");
+		goto complete;
+	}
+	if(jerasure_invert_matrix(E,inverse,symbols,w)<0){
+		printf("The systematic devices can not rebuild the data.\n");
+		goto complete;
+	}
+	generator = jerasure_matrix_multiply(E+symbols*symbols,inverse,(n-k)*alpha,symbols,symbols,symbols,w);
+complete:
+	free(E);
+	free(inverse);
+	return(generator);
+}
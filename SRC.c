@@ -27,6 +27,7 @@ THIS SOFTWARE IS PROVIDED BY AT&T INTELLECTUAL PROPERTY ''AS IS'' AND ANY EXPRES
 #include <stdlib.h>
 #include <string.h>
 #include "jerasure.h"
+#include "jerasure_add.h"
 #include "reed_sol.h"
 
 #include "regenerating_codes.h"
@@ -53,108 +54,200 @@ Restriction: alphabet size 2^w>=n.
 */
 
 int encode_SRC(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info)
+{
+	int subpacket_size = input_size/(info->req.k*info->req.f);	
+	return(encode_rc_region(input, output, subpacket_size, subpacket_size, info));
+}
+
+// the body of encode_SRC_iov(), see SPECIALIZED_SRC
+SPECIALIZABLE int encode_SRC_iov_body(char **data, char **output, int subpacket_size, int length, int n, int k, int f, struct coding_info *info)
 {
 	int i,j;	
-	int n = info->req.n;
-	int k = info->req.k;
-	int f = info->req.f;
-	int subpacket_size = input_size/(k*f);	
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_plus_coding_ptrs, **ptrs;
+	if(ws==NULL||(info->backend==BITMATRIX_BACKEND&&get_schedule(info)==NULL))
+		return(-1);
   
 	// rearrange the memory pointers in preparation for encoding
-	char **data_plus_coding_ptrs = malloc(sizeof(char*)*n); 
-	if(data_plus_coding_ptrs==NULL){
+	mark = workspace_mark(ws);
+	data_plus_coding_ptrs = workspace_alloc(ws, sizeof(char*)*n); 
+	ptrs = workspace_alloc(ws, sizeof(char*)*n);
+	if(data_plus_coding_ptrs==NULL||ptrs==NULL){
 		printf("Out of memory.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}	
-	for(i=0;i<k;i++) // i-th device
-		memcpy(output[i],input+i*f*subpacket_size,subpacket_size*f);			
+	for(i=0;i<k;i++){ // i-th device
+		for(j=0;j<f;j++)
+			copy_region(output[i]+j*subpacket_size, data[i*f+j], length);			
+	}
 
-	// call jerasure routine for encoding;
-	jerasure_schedule_encode(k, n-k, info->req.w, 
-			info->schedule, output, output+k, 
-			subpacket_size*f, ALIGNMENT);
+	// call jerasure routine for encoding, one subpacket position at a time
+	for(j=0;j<f;j++){
+		for(i=0;i<n;i++)
+			data_plus_coding_ptrs[i] = output[i]+j*subpacket_size;
+		if(encode_by_matrix(0, data_plus_coding_ptrs, data_plus_coding_ptrs+k, ptrs, 
+				length, info)<0){
+			workspace_release(ws, mark);
+			return(-1);
+		}
+	}
 
 	for(i=0;i<n;i++){
 		for(j=0; j<f;j++)// reuse these pointers for the correct data blocks before XORs vertically/diagonally			
 			data_plus_coding_ptrs[j] = output[(i+j)%n]+j*subpacket_size;
-		jerasure_do_parity(f, data_plus_coding_ptrs, output[(i+f)%n] + f*subpacket_size, subpacket_size);
+		xor_regions(data_plus_coding_ptrs, f, output[(i+f)%n] + f*subpacket_size, length, 0);
 	}
 	
 	// clean up
-	free(data_plus_coding_ptrs);       
+	workspace_release(ws, mark);
 	return(1);
 }
 
+#define ENCODE_SRC_SPECIALIZED(N,K,F) \
+	if(n==N&&k==K&&f==F) \
+		return(encode_SRC_iov_body(data, output, subpacket_size, length, N, K, F, info));
+
+// encodes bytes [0,length) of every subpacket, the buffers being laid out in subpackets of subpacket_size
+int encode_SRC_iov(char **data, char **output, int subpacket_size, int length, struct coding_info *info)
+{
+	int n = info->req.n;
+	int k = info->req.k;
+	int f = info->req.f;
+	SPECIALIZED_SRC(ENCODE_SRC_SPECIALIZED)
+	return(encode_SRC_iov_body(data, output, subpacket_size, length, n, k, f, info));
+}
+
+int make_decode_plan_SRC(struct decode_plan *plan, struct coding_info *info)
+{
+	plan->num_of_schedules = 1;
+	plan->erasures_array = calloc(1,sizeof(int*)); // NULL: the schedule is for plan->erasures itself
+	plan->schedule_array = calloc(1,sizeof(struct jerasure_flat_schedule*));
+	if(plan->erasures_array==NULL||plan->schedule_array==NULL){
+		printf("Out of memory.\n");
+		return(-1);
+	}
+	return(make_plan_decoding(plan, 0, 0, plan->erasures, info));
+}
+
 int decode_SRC(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info)
+{
+	int ret;
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	if(plan==NULL)
+		return(-1);
+	ret = decode_SRC_with_plan(input, input_size, output, output_size, plan, info);
+	free_decode_plan(plan);
+	return(ret);
+}
+
+int decode_SRC_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info)
+{
+	int subpacket_size = output_size/(info->req.k*info->req.f);	       
+	return(decode_rc_region(input, output, subpacket_size, subpacket_size, plan, info));
+}
+
+int decode_SRC_iov(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info)
 {
 	int i, j;
 	int n = info->req.n;
 	int k = info->req.k;
 	int f = info->req.f;
-	int subpacket_size = output_size/k;	       
+	int* erased = plan->erased;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_plus_coding_ptrs, **ptrs;
+	if(ws==NULL)
+		return(-1);
        
 	// allocate memory for data arrangement
-	char** data_plus_coding_ptrs = malloc(sizeof(char*)*n);
-	if(data_plus_coding_ptrs==NULL){
+	mark = workspace_mark(ws);
+	data_plus_coding_ptrs = workspace_alloc(ws, sizeof(char*)*n);
+	ptrs = workspace_alloc(ws, sizeof(char*)*n);
+	if(data_plus_coding_ptrs==NULL||ptrs==NULL){
 		printf("Out of memory.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}
 	
-	jerasure_schedule_decode_lazy(k, n-k, info->req.w, 
-			info->bitmatrix, erasures, 
-			input, input+k, 	
-		        subpacket_size, ALIGNMENT, 0);
+	for(j=0;j<f;j++){
+		for(i=0;i<n;i++)
+			data_plus_coding_ptrs[i] = input[i]+j*subpacket_size;
+		decode_by_plan(plan, 0, k, n-k, 
+				data_plus_coding_ptrs, data_plus_coding_ptrs+k, ptrs, 	
+			        length, info);
+	}
 
-	for(i=0;i<k;i++) // i-th device
-		memcpy(output+i*subpacket_size,input[i],subpacket_size);	
+	for(i=0;i<k;i++){ // i-th device
+		for(j=0;j<f;j++)
+			place_region(&output[i*f+j], input[i]+j*subpacket_size, length);	
+	}
 
-	
-	int* erased = jerasure_erasures_to_erased(n, n-k, erasures);
-	subpacket_size = subpacket_size/f;
 	for(i=0;i<n;i++){
 		if(erased[(i+f)%n]!=1)
 			continue;
 		for(j=0; j<f;j++)// reuse these pointers for the correct data blocks before XORs vertically/diagonally			
 			data_plus_coding_ptrs[j] = input[(i+j)%n]+j*subpacket_size;
-		jerasure_do_parity(f, data_plus_coding_ptrs, input[(i+f)%n] + f*subpacket_size, subpacket_size);
+		xor_regions(data_plus_coding_ptrs, f, input[(i+f)%n] + f*subpacket_size, length, 0);
 	}
-	free(data_plus_coding_ptrs);
-	free(erased);
+	workspace_release(ws, mark);
 	return(1);
 }
 
 int repair_encode_SRC(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info)
 {
+	int subpacket_size = input_size/(info->req.f+1);		
+	return(repair_encode_SRC_region(input, output, subpacket_size, subpacket_size, from_device_ID, to_device_ID, info));
+}
+
+int repair_encode_SRC_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info)
+{
+	int i;
 	int f = info->req.f;
 	int n = info->req.n;
-	int subpacket_size = input_size/(f+1);		
 
 	// repair encoding is a simple copy operation
 	int distance = (from_device_ID-to_device_ID+n)%n;
 	int shift = 0;
 	if(distance<=f){
-		shift = subpacket_size*(f+1-distance);
-		memcpy(output,input+subpacket_size*(distance),shift);
+		shift = f+1-distance;
+		for(i=0;i<shift;i++)
+			copy_region(output+i*subpacket_size,input+(distance+i)*subpacket_size,length);
 	}
 	distance = (to_device_ID-from_device_ID+n)%n;
-	if(distance<=f)
-		memcpy(output+shift,input,subpacket_size*(f+1-distance));	
+	if(distance<=f){
+		for(i=0;i<f+1-distance;i++)
+			copy_region(output+(shift+i)*subpacket_size,input+i*subpacket_size,length);	
+	}
 	
 	return(1);
 }
 
 int repair_decode_SRC(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info)
+{
+	int subpacket_size = input_size/(info->req.f+1);
+	return(repair_decode_SRC_region(input, output, subpacket_size, subpacket_size, to_device_ID, helpers, info));
+}
+
+int repair_decode_SRC_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info)
 {
 	int i,j, counter;
 	int f = info->req.f;
 	int n = info->req.n;
 	int d = info->req.d;
-	int subpacket_size = input_size/(f+1);
-	char **data_ptrs = malloc(sizeof(char*)*f);	
 	int distance,shift;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data_ptrs;
 	
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	data_ptrs = workspace_alloc(ws, sizeof(char*)*f);	
 	if(data_ptrs==NULL){
 		printf("Can not allocate memory.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}
 	for(i=0,counter=0;i<n&&helpers[i]>=0;i++){
@@ -164,9 +257,9 @@ int repair_decode_SRC(char **input, size_t input_size, char *output, size_t outp
 	}
 	if(counter!=d){
 		printf("Insufficient number of helpers.\n");
+		workspace_release(ws, mark);
 		return(-1);
 	}
-	memset(output,0,output_size);
 	for(j=0;j<f+1;j++){			
 		for(i=0,counter=0;i<d;i++){
 			distance = (helpers[i]-to_device_ID+n)%n;
@@ -184,10 +277,10 @@ int repair_decode_SRC(char **input, size_t input_size, char *output, size_t outp
 			}
 			
 		}		
-		jerasure_do_parity(f, data_ptrs, (output+j*subpacket_size), subpacket_size);
+		xor_regions(data_ptrs, f, (output+j*subpacket_size), length, 0);
 	}
 	
-	free(data_ptrs);
+	workspace_release(ws, mark);
 	
 	return(1);
 }
@@ -21,8 +21,12 @@ THIS SOFTWARE IS PROVIDED BY AT&T INTELLECTUAL PROPERTY ''AS IS'' AND ANY EXPRES
 # $Revision: 0.1 $
 # $Date: 2014/02/25 $
 */
+#include <stdlib.h>
+#include <string.h>
 #include "jerasure.h"
 #include "jerasure_add.h"
+#include "cauchy.h"
+#include "xor_kernels.h"
 
 //added this function for cases where bitmatrix does not needs to be allocated each time
 
@@ -52,3 +56,657 @@ void jerasure_matrix_to_bitmatrix_noallocate(int k, int m, int w, int *matrix, i
   }
 }
 
+/* same pointer arrangement as set_up_ptrs_for_scheduled_decoding(), in the k+m pointers of ptrs */
+static void set_up_ptrs_noallocate(int k, int m, int *erased, char **data_ptrs, char **coding_ptrs, char **ptrs)
+{
+  int i, j, x;
+
+  j = k;
+  x = k;
+  for (i = 0; i < k; i++) {
+    if (erased[i] == 0) {
+      ptrs[i] = data_ptrs[i];
+    } else {
+      while (erased[j]) j++;
+      ptrs[i] = coding_ptrs[j-k];
+      j++;
+      ptrs[x] = data_ptrs[i];
+      x++;
+    }
+  }
+  for (i = k; i < k+m; i++) {
+    if (erased[i]) {
+      ptrs[x] = coding_ptrs[i-k];
+      x++;
+    }
+  }
+}
+
+//added this function for cases where the same decoding schedule is used many times. erased is the erased form of the 
+//erasures the schedule was generated for, and ptrs is room for k+m pointers, so that nothing is allocated here
+
+int jerasure_schedule_decode_with_schedule(int k, int m, int w, int **schedule, int *erased, char **data_ptrs, char **coding_ptrs, char **ptrs, int size, int packetsize)
+{
+  int i, tdone;
+
+  set_up_ptrs_noallocate(k, m, erased, data_ptrs, coding_ptrs, ptrs);
+  for (tdone = 0; tdone < size; tdone += packetsize*w) {
+    jerasure_do_scheduled_operations(ptrs, schedule, packetsize);
+    for (i = 0; i < k+m; i++) ptrs[i] += (packetsize*w);
+  }
+  return 0;
+}
+
+//added this function for schedules compiled into functions by schedule_compiler: it is called like 
+//jerasure_schedule_encode_noallocate() below, with the compiled function in place of the schedule
+
+void jerasure_compiled_encode_noallocate(int k, int m, int w, void (*operations)(char **ptrs, char *temps, int packetsize), char **data_ptrs, char **coding_ptrs, char **ptrs, char *scratch, int size, int packetsize)
+{
+  int i, tdone;
+
+  for (i = 0; i < k; i++) ptrs[i] = data_ptrs[i];
+  for (i = 0; i < m; i++) ptrs[i+k] = coding_ptrs[i];
+  for (tdone = 0; tdone < size; tdone += packetsize*w) {
+    operations(ptrs, scratch, packetsize);
+    for (i = 0; i < k+m; i++) ptrs[i] += (packetsize*w);
+  }
+}
+
+//added this function for encoding with a caller supplied array of k+m pointers instead of allocating one each time
+
+void jerasure_schedule_encode_noallocate(int k, int m, int w, int **schedule, char **data_ptrs, char **coding_ptrs, char **ptrs, int size, int packetsize)
+{
+  int i, tdone;
+
+  for (i = 0; i < k; i++) ptrs[i] = data_ptrs[i];
+  for (i = 0; i < m; i++) ptrs[i+k] = coding_ptrs[i];
+  for (tdone = 0; tdone < size; tdone += packetsize*w) {
+    jerasure_do_scheduled_operations(ptrs, schedule, packetsize);
+    for (i = 0; i < k+m; i++) ptrs[i] += (packetsize*w);
+  }
+}
+
+//added these functions for schedules in struct-of-arrays form. A jerasure schedule has one allocation per 5-int 
+//operation, and its interpreter follows a pointer and calls galois_region_xor() or memcpy() for each of them. The 
+//flat form is one block, and each run of operations writing the same packet is a single xor_regions() call.
+
+#define FLAT_PASS_BYTES (256*1024) /* how much jerasure_flat_encode_noallocate() reads and writes in one pass */
+#define FLAT_BATCH 32              /* sources given to xor_regions() at once */
+#define FLAT_HEADER 5              /* ints before the arrays in the data block */
+
+static struct jerasure_flat_schedule *set_up_flat_schedule(struct jerasure_flat_schedule *schedule, int *data)
+{
+  int r = data[0];
+  int s = data[1];
+
+  schedule->num_of_runs = r;
+  schedule->num_of_srcs = s;
+  schedule->max_run = data[2];
+  schedule->num_of_temps = data[3];
+  schedule->temp_id = data[4];
+  schedule->dest_id = data+FLAT_HEADER;
+  schedule->dest_packet = schedule->dest_id+r;
+  schedule->add = schedule->dest_packet+r;
+  schedule->first_src = schedule->add+r;
+  schedule->src_id = schedule->first_src+r+1;
+  schedule->src_packet = schedule->src_id+s;
+  schedule->data = data;
+  schedule->size = FLAT_HEADER+1+4*r+2*s;
+  return schedule;
+}
+
+struct jerasure_flat_schedule *jerasure_flatten_schedule(int **schedule, int temp_id, int num_of_temps)
+{
+  int i, r, s, num, runs, srcs;
+  int *data;
+  struct jerasure_flat_schedule *flat;
+
+  if (schedule == NULL) return NULL;
+  runs = 0;
+  for (i = 0; schedule[i][0] >= 0; i += num) {
+    for (num = 1; schedule[i+num][0] >= 0 && schedule[i+num][4] == 1 && schedule[i+num][2] == schedule[i][2] 
+         && schedule[i+num][3] == schedule[i][3]; num++) ;
+    runs++;
+  }
+  srcs = i;
+
+  /* the struct and its data in one allocation, freed with a single free() */
+  flat = (struct jerasure_flat_schedule *) malloc(sizeof(struct jerasure_flat_schedule)+sizeof(int)*(FLAT_HEADER+1+4*runs+2*srcs));
+  if (flat == NULL) return NULL;
+  data = (int *) (flat+1);
+  data[0] = runs;
+  data[1] = srcs;
+  data[2] = 0;
+  data[3] = num_of_temps;
+  data[4] = (num_of_temps > 0) ? temp_id : -1;
+  set_up_flat_schedule(flat, data);
+
+  r = 0;
+  s = 0;
+  for (i = 0; schedule[i][0] >= 0; i += num) {
+    for (num = 1; schedule[i+num][0] >= 0 && schedule[i+num][4] == 1 && schedule[i+num][2] == schedule[i][2] 
+         && schedule[i+num][3] == schedule[i][3]; num++) ;
+    flat->dest_id[r] = schedule[i][2];
+    flat->dest_packet[r] = schedule[i][3];
+    flat->add[r] = schedule[i][4];
+    flat->first_src[r] = s;
+    for (; s < i+num; s++) {
+      flat->src_id[s] = schedule[s][0];
+      flat->src_packet[s] = schedule[s][1];
+    }
+    if (num > data[2]) data[2] = num;
+    r++;
+  }
+  flat->first_src[r] = s;
+  flat->max_run = data[2];
+  return flat;
+}
+
+/* checks the operations as well as the layout, since the ids and packets index the caller's pointers and buffers */
+static int flat_operation_is_valid(struct jerasure_flat_schedule *flat, int id, int packet, int num_of_devices, int w)
+{
+  if (id >= 0 && id < num_of_devices) return (packet >= 0 && packet < w);
+  return (id == flat->temp_id && packet >= 0 && packet < flat->num_of_temps);
+}
+
+struct jerasure_flat_schedule *jerasure_map_flat_schedule(int *data, int size, int num_of_devices, int w)
+{
+  int r, s, max_run;
+  struct jerasure_flat_schedule *flat;
+
+  if (size < FLAT_HEADER+1 || data[0] < 0 || data[1] < 0 || data[3] < 0 
+      || (long long) FLAT_HEADER+1+4LL*data[0]+2LL*data[1] != size) return NULL;
+  if ((data[3] == 0) ? data[4] != -1 : data[4] != num_of_devices) return NULL;
+  flat = (struct jerasure_flat_schedule *) malloc(sizeof(struct jerasure_flat_schedule));
+  if (flat == NULL) return NULL;
+  set_up_flat_schedule(flat, data);
+  max_run = 0;
+  for (r = 0; r < flat->num_of_runs; r++) {
+    if (flat->first_src[r] < 0 || flat->first_src[r] >= flat->first_src[r+1]) break;
+    if (flat->add[r] != 0 && flat->add[r] != 1) break;
+    if (!flat_operation_is_valid(flat, flat->dest_id[r], flat->dest_packet[r], num_of_devices, w)) break;
+    if (flat->first_src[r+1] > flat->num_of_srcs) break;
+    for (s = flat->first_src[r]; s < flat->first_src[r+1]; s++) {
+      if (!flat_operation_is_valid(flat, flat->src_id[s], flat->src_packet[s], num_of_devices, w)) break;
+    }
+    if (s < flat->first_src[r+1]) break;
+    if (flat->first_src[r+1]-flat->first_src[r] > max_run) max_run = flat->first_src[r+1]-flat->first_src[r];
+  }
+  if (r < flat->num_of_runs || flat->first_src[r] != flat->num_of_srcs || flat->max_run != max_run) {
+    free(flat);
+    return NULL;
+  }
+  return flat;
+}
+
+void jerasure_free_flat_schedule(struct jerasure_flat_schedule *schedule)
+{
+  free(schedule);
+}
+
+int jerasure_flat_schedule_xors(struct jerasure_flat_schedule *schedule)
+{
+  int r, xors;
+
+  xors = 0;
+  for (r = 0; r < schedule->num_of_runs; r++) {
+    xors += schedule->first_src[r+1]-schedule->first_src[r]-1+schedule->add[r];
+  }
+  return xors;
+}
+
+void jerasure_do_flat_operations(char **ptrs, struct jerasure_flat_schedule *schedule, int packetsize, int stride, int count)
+{
+  int r, i, j, c, num, add, id;
+  int temp_stride = schedule->num_of_temps*packetsize;
+  char *src[FLAT_BATCH];
+  char *dest;
+
+  /* the temporaries of the c-th group are the c-th num_of_temps packets of ptrs[temp_id] */
+  for (r = 0; r < schedule->num_of_runs; r++) {
+    dest = ptrs[schedule->dest_id[r]]+schedule->dest_packet[r]*packetsize;
+    for (c = 0; c < count; c++) {
+      add = schedule->add[r];
+      for (i = schedule->first_src[r]; i < schedule->first_src[r+1]; i += num) {
+        num = schedule->first_src[r+1]-i;
+        if (num > FLAT_BATCH) num = FLAT_BATCH;
+        for (j = 0; j < num; j++) {
+          id = schedule->src_id[i+j];
+          src[j] = ptrs[id]+schedule->src_packet[i+j]*packetsize+c*((id == schedule->temp_id) ? temp_stride : stride);
+        }
+        xor_regions(src, num, dest+c*((schedule->dest_id[r] == schedule->temp_id) ? temp_stride : stride), packetsize, add);
+        add = 1;
+      }
+    }
+  }
+}
+
+static int flat_pass(int k, int m, int w, int packetsize)
+{
+  int pass = FLAT_PASS_BYTES/(packetsize*w*(k+m));
+
+  return (pass < 1) ? 1 : pass;
+}
+
+int jerasure_flat_scratch_size(int k, int m, int w, struct jerasure_flat_schedule *schedule, int packetsize)
+{
+  return schedule->num_of_temps*packetsize*flat_pass(k, m, w, packetsize);
+}
+
+void jerasure_flat_encode_noallocate(int k, int m, int w, struct jerasure_flat_schedule *schedule, char **data_ptrs, char **coding_ptrs, char **ptrs, char *scratch, int size, int packetsize)
+{
+  int i, tdone, count;
+  int chunk = packetsize*w;
+  int pass = flat_pass(k, m, w, packetsize);
+
+  for (i = 0; i < k; i++) ptrs[i] = data_ptrs[i];
+  for (i = 0; i < m; i++) ptrs[i+k] = coding_ptrs[i];
+  if (schedule->num_of_temps > 0) ptrs[k+m] = scratch;
+  for (tdone = 0; tdone < size; tdone += chunk*count) {
+    count = (size-tdone+chunk-1)/chunk;
+    if (count > pass) count = pass;
+    jerasure_do_flat_operations(ptrs, schedule, packetsize, chunk, count);
+    for (i = 0; i < k+m; i++) ptrs[i] += chunk*count;
+  }
+}
+
+void jerasure_flat_decode_noallocate(int k, int m, int w, struct jerasure_flat_schedule *schedule, int *erased, char **data_ptrs, char **coding_ptrs, char **ptrs, int size, int packetsize)
+{
+  int i, tdone, count;
+  int chunk = packetsize*w;
+  int pass = flat_pass(k, m, w, packetsize);
+
+  set_up_ptrs_noallocate(k, m, erased, data_ptrs, coding_ptrs, ptrs);
+  for (tdone = 0; tdone < size; tdone += chunk*count) {
+    count = (size-tdone+chunk-1)/chunk;
+    if (count > pass) count = pass;
+    jerasure_do_flat_operations(ptrs, schedule, packetsize, chunk, count);
+    for (i = 0; i < k+m; i++) ptrs[i] += chunk*count;
+  }
+}
+
+//added this function to schedule a bitmatrix with fewer XORs than jerasure_smart_bitmatrix_to_schedule(), which 
+//only computes a row from a previous one. It repeatedly takes the pair of packets that the most rows have in common, 
+//XORs it once into a temporary packet and replaces it by the temporary in those rows (common subexpression 
+//elimination by greedy pair matching). Temporaries are packets of device k+m. If this does not beat the smart 
+//schedule, the smart schedule is returned with *num_of_temps set to 0. xors, if not NULL, gets the XOR counts of the 
+//smart schedule and of the returned one.
+
+static int *schedule_operation(int sd, int sb, int dd, int db, int op)
+{
+  int *operation = (int *) malloc(sizeof(int)*5);
+
+  if (operation == NULL) return NULL;
+  operation[0] = sd;
+  operation[1] = sb;
+  operation[2] = dd;
+  operation[3] = db;
+  operation[4] = op;
+  return operation;
+}
+
+static int count_schedule_xors(int **schedule)
+{
+  int i, xors;
+
+  xors = 0;
+  for (i = 0; schedule[i][0] >= 0; i++) {
+    if (schedule[i][4] == 1) xors++;
+  }
+  return xors;
+}
+
+int **jerasure_optimized_bitmatrix_to_schedule(int k, int m, int w, int *bitmatrix, int *num_of_temps, int *xors)
+{
+  int i, j, x, y, r, t, a, b, best, ops, smart_xors, opt_xors;
+  int inputs = k*w;
+  int rows = m*w;
+  int max_temps = inputs+rows;
+  int vars = inputs+max_temps;
+  char *member;            /* member[r*vars+v]: row r has variable v */
+  int *count;              /* count[a*vars+b], a < b: the rows having both */
+  int *pair_a, *pair_b;    /* temporary t is variable inputs+t, the XOR of these two */
+  int **smart, **schedule;
+
+  *num_of_temps = 0;
+  smart = jerasure_smart_bitmatrix_to_schedule(k, m, w, bitmatrix);
+  if (smart == NULL) return NULL;
+  smart_xors = count_schedule_xors(smart);
+  if (xors != NULL) xors[0] = xors[1] = smart_xors;
+
+  member = (char *) calloc((size_t) rows*vars, 1);
+  count = (int *) calloc((size_t) vars*vars, sizeof(int));
+  pair_a = (int *) malloc(sizeof(int)*max_temps);
+  pair_b = (int *) malloc(sizeof(int)*max_temps);
+  if (member == NULL || count == NULL || pair_a == NULL || pair_b == NULL) {
+    free(member); free(count); free(pair_a); free(pair_b);
+    return smart;
+  }
+  for (r = 0; r < rows; r++) {
+    for (i = 0; i < inputs; i++) member[r*vars+i] = (bitmatrix[r*inputs+i] != 0);
+    for (i = 0; i < inputs; i++) {
+      if (!member[r*vars+i]) continue;
+      for (j = i+1; j < inputs; j++) {
+        if (member[r*vars+j]) count[i*vars+j]++;
+      }
+    }
+  }
+
+  for (t = 0; t < max_temps; t++) {
+    best = 1;
+    a = b = -1;
+    for (i = 0; i < inputs+t; i++) {
+      for (j = i+1; j < inputs+t; j++) {
+        if (count[i*vars+j] > best) {
+          best = count[i*vars+j];
+          a = i;
+          b = j;
+        }
+      }
+    }
+    if (a < 0) break;
+    pair_a[t] = a;
+    pair_b[t] = b;
+    x = inputs+t;
+    for (r = 0; r < rows; r++) {
+      if (!member[r*vars+a] || !member[r*vars+b]) continue;
+      member[r*vars+a] = member[r*vars+b] = 0;
+      count[a*vars+b]--;
+      for (y = 0; y < x; y++) {
+        if (!member[r*vars+y]) continue;
+        count[((y < a) ? y*vars+a : a*vars+y)]--;
+        count[((y < b) ? y*vars+b : b*vars+y)]--;
+        count[y*vars+x]++;
+      }
+      member[r*vars+x] = 1;
+    }
+  }
+
+  opt_xors = t;
+  ops = 2*t;
+  for (r = 0; r < rows; r++) {
+    for (y = 0, i = 0; y < inputs+t; y++) i += member[r*vars+y];
+    if (i > 0) opt_xors += i-1;
+    ops += i;
+  }
+  if (opt_xors >= smart_xors || (schedule = (int **) malloc(sizeof(int *)*(ops+1))) == NULL) {
+    free(member); free(count); free(pair_a); free(pair_b);
+    return smart;
+  }
+
+  /* a variable v is packet v%w of device v/w, or temporary v-inputs */
+  i = 0;
+  for (x = 0; x < t; x++) {
+    a = pair_a[x];
+    b = pair_b[x];
+    schedule[i++] = schedule_operation((a < inputs) ? a/w : k+m, (a < inputs) ? a%w : a-inputs, k+m, x, 0);
+    schedule[i++] = schedule_operation((b < inputs) ? b/w : k+m, (b < inputs) ? b%w : b-inputs, k+m, x, 1);
+  }
+  for (r = 0; r < rows; r++) {
+    for (y = 0, j = 0; y < inputs+t; y++) {
+      if (!member[r*vars+y]) continue;
+      schedule[i++] = schedule_operation((y < inputs) ? y/w : k+m, (y < inputs) ? y%w : y-inputs, k+r/w, r%w, (j > 0));
+      j++;
+    }
+  }
+  schedule[i] = schedule_operation(-1, 0, 0, 0, 0);
+  for (j = 0; j <= i; j++) {
+    if (schedule[j] == NULL) break;
+  }
+  free(member); free(count); free(pair_a); free(pair_b);
+  if (j <= i) {
+    for (x = 0; x <= i; x++) free(schedule[x]);
+    free(schedule);
+    return smart;
+  }
+  jerasure_free_schedule(smart);
+  *num_of_temps = t;
+  if (xors != NULL) xors[1] = opt_xors;
+  return schedule;
+}
+
+//added these functions for bitmatrices packed 32 bits to a word. Even the n*d*w*w bitmatrix of product-matrix MSR 
+//codes then fits in L1 or L2, and a dotprod skips zero words instead of testing every bit.
+
+int jerasure_packed_bitmatrix_words(int k, int m, int w)
+{
+  return m*w*JERASURE_PACKED_ROW_WORDS(k, w);
+}
+
+unsigned int *jerasure_matrix_to_packed_bitmatrix(int k, int m, int w, int *matrix)
+{
+  int i, j, x, y, elt, bit;
+  int words = JERASURE_PACKED_ROW_WORDS(k, w);
+  unsigned int *bitmatrix, *row;
+
+  bitmatrix = (unsigned int *) calloc(jerasure_packed_bitmatrix_words(k, m, w), sizeof(unsigned int));
+  if (bitmatrix == NULL) return NULL;
+  for (i = 0; i < m; i++) {
+    for (j = 0; j < k; j++) {
+      elt = matrix[i*k+j];
+      /* column y of the w*w block of elt is elt*2^y, as in jerasure_matrix_to_bitmatrix() */
+      for (y = 0; y < w; y++) {
+        for (x = 0; x < w; x++) {
+          if (elt & (1 << x)) {
+            row = bitmatrix+(i*w+x)*words;
+            bit = j*w+y;
+            row[bit/32] |= 1u << (bit%32);
+          }
+        }
+        elt = galois_single_multiply(elt, 2, w);
+      }
+    }
+  }
+  return bitmatrix;
+}
+
+void jerasure_packed_bitmatrix_dotprod(int k, int w, unsigned int *bitmatrix, int row, int *src_ids, int dest_id, char **data_ptrs, char **coding_ptrs, int size, int packetsize)
+{
+  int i, j, x, num, bit, sindex;
+  int words = JERASURE_PACKED_ROW_WORDS(k, w);
+  unsigned int word, *bitrow;
+  char *src[FLAT_BATCH];
+  char *sptr, *dptr;
+
+  dptr = (dest_id < k) ? data_ptrs[dest_id] : coding_ptrs[dest_id-k];
+  for (sindex = 0; sindex < size; sindex += packetsize*w) {
+    for (j = 0; j < w; j++) {
+      bitrow = bitmatrix+(row*w+j)*words;
+      num = 0;
+      x = 0;   /* 0 until the packet is started, as a packet with no bits is left untouched */
+      for (i = 0; i < words; i++) {
+        for (word = bitrow[i]; word != 0; word &= word-1) {
+          bit = i*32+__builtin_ctz(word);
+          if (src_ids == NULL) sptr = data_ptrs[bit/w];
+          else if (src_ids[bit/w] < k) sptr = data_ptrs[src_ids[bit/w]];
+          else sptr = coding_ptrs[src_ids[bit/w]-k];
+          src[num++] = sptr+sindex+(bit%w)*packetsize;
+          if (num == FLAT_BATCH) {
+            xor_regions(src, num, dptr+sindex+j*packetsize, packetsize, x);
+            num = 0;
+            x = 1;
+          }
+        }
+      }
+      if (num > 0) xor_regions(src, num, dptr+sindex+j*packetsize, packetsize, x);
+    }
+  }
+}
+
+void jerasure_packed_bitmatrix_encode(int k, int m, int w, unsigned int *bitmatrix, char **data_ptrs, char **coding_ptrs, int size, int packetsize)
+{
+  int i;
+
+  for (i = 0; i < m; i++) {
+    jerasure_packed_bitmatrix_dotprod(k, w, bitmatrix, i, NULL, k+i, data_ptrs, coding_ptrs, size, packetsize);
+  }
+}
+
+//added these two functions to compute several rows over the same sources in one pass: each block of the sources is 
+//used for all the rows while it is in the cache, instead of being read again for every row. dests[r] gets row rows[r] 
+//times the sources, or is XORed with it if add is set. Unlike the dotprods, a zero row clears dests[r] unless add is set.
+
+void jerasure_packed_bitmatrix_multi_dotprod(int k, int w, unsigned int *bitmatrix, int *rows, int num_rows, char **data_ptrs, char **dests, int size, int packetsize, int add)
+{
+  int i, j, r, x, num, bit, sindex;
+  int words = JERASURE_PACKED_ROW_WORDS(k, w);
+  unsigned int word, *bitrow;
+  char *src[FLAT_BATCH];
+  char *dptr;
+
+  for (sindex = 0; sindex < size; sindex += packetsize*w) {
+    for (r = 0; r < num_rows; r++) {
+      for (j = 0; j < w; j++) {
+        bitrow = bitmatrix+(rows[r]*w+j)*words;
+        dptr = dests[r]+sindex+j*packetsize;
+        num = 0;
+        x = add;
+        for (i = 0; i < words; i++) {
+          for (word = bitrow[i]; word != 0; word &= word-1) {
+            bit = i*32+__builtin_ctz(word);
+            src[num++] = data_ptrs[bit/w]+sindex+(bit%w)*packetsize;
+            if (num == FLAT_BATCH) {
+              xor_regions(src, num, dptr, packetsize, x);
+              num = 0;
+              x = 1;
+            }
+          }
+        }
+        if (num > 0) xor_regions(src, num, dptr, packetsize, x);
+        else if (!x) memset(dptr, 0, packetsize);
+      }
+    }
+  }
+}
+
+void jerasure_matrix_multi_dotprod(int k, int w, int *matrix, int *rows, int num_rows, char **data_ptrs, char **dests, int size, int add)
+{
+  int i, r, x, c, len, sindex;
+  int block = (FLAT_PASS_BYTES/(k+num_rows)) & ~63;
+  char *sptr, *dptr;
+
+  if (block < 64) block = 64;
+  for (sindex = 0; sindex < size; sindex += block) {
+    len = (size-sindex < block) ? size-sindex : block;
+    for (r = 0; r < num_rows; r++) {
+      dptr = dests[r]+sindex;
+      x = add;
+      for (i = 0; i < k; i++) {
+        c = matrix[rows[r]*k+i];
+        if (c == 0) continue;
+        sptr = data_ptrs[i]+sindex;
+        if (c == 1) {
+          if (x) xor_region(sptr, dptr, len);
+          else memcpy(dptr, sptr, len);
+        } else {
+          switch (w) {
+            case 8:  galois_w08_region_multiply(sptr, c, len, dptr, x); break;
+            case 16: galois_w16_region_multiply(sptr, c, len, dptr, x); break;
+            case 32: galois_w32_region_multiply(sptr, c, len, dptr, x); break;
+          }
+        }
+        x = 1;
+      }
+      if (!x) memset(dptr, 0, len);
+    }
+  }
+}
+
+//added these two functions for the search of low-density coding matrices. Scaling a row or column of a Cauchy or 
+//product-matrix encoding matrix keeps its properties, so each row and column can take the scale with the fewest ones.
+
+int *jerasure_make_ones_table(int w)
+{
+  int i, *ones;
+
+  if (w > 16) return NULL;
+  ones = (int *) malloc(sizeof(int)*(1 << w));
+  if (ones == NULL) return NULL;
+  for (i = 0; i < (1 << w); i++) ones[i] = cauchy_n_ones(i, w);
+  return ones;
+}
+
+int jerasure_best_scale(int *elts, int num, int w, int *ones, int scale, int *cost)
+{
+  int i, j, c, best, sum;
+
+  best = scale;
+  *cost = 0;
+  for (j = 0; j < num; j++) *cost += ones[galois_single_multiply(elts[j], scale, w)];
+  for (i = 0; i < num; i++) {
+    if (elts[i] == 0) continue;
+    c = galois_single_divide(1, elts[i], w);
+    for (j = 0, sum = 0; j < num && sum < *cost; j++) sum += ones[galois_single_multiply(elts[j], c, w)];
+    if (sum < *cost) {
+      *cost = sum;
+      best = c;
+    }
+  }
+  return best;
+}
+
+//added this function for decoding with matrices instead of bitmatrices. It puts the first k devices that are not erased 
+//in src_ids, and for the i-th entry of erasures, the k coefficients recovering that device from the src_ids devices in 
+//rows+i*k. Erased coding devices are also expressed in the src_ids devices, so nothing depends on a decoded device.
+
+int jerasure_make_decoding_rows(int k, int m, int w, int *matrix, int *erasures, int *rows, int *src_ids)
+{
+  int i, j, e, x;
+  int *erased, *decoding, *inverse;
+
+  erased = jerasure_erasures_to_erased(k, m, erasures);
+  if (erased == NULL) return -1;
+  decoding = (int *) malloc(sizeof(int)*k*k*2);
+  if (decoding == NULL) {
+    free(erased);
+    return -1;
+  }
+  inverse = decoding + k*k;
+
+  for (i = 0, j = 0; i < k+m && j < k; i++) {
+    if (erased[i]) continue;
+    src_ids[j] = i;
+    if (i < k) {
+      memset(decoding+j*k, 0, sizeof(int)*k);
+      decoding[j*k+i] = 1;
+    } else {
+      memcpy(decoding+j*k, matrix+(i-k)*k, sizeof(int)*k);
+    }
+    j++;
+  }
+  free(erased);
+  if (j < k || jerasure_invert_matrix(decoding, inverse, k, w) < 0) {
+    free(decoding);
+    return -1;
+  }
+
+  for (e = 0; erasures[e] != -1; e++) {
+    if (erasures[e] < k) {
+      memcpy(rows+e*k, inverse+erasures[e]*k, sizeof(int)*k);
+      continue;
+    }
+    for (j = 0; j < k; j++) {
+      x = 0;
+      for (i = 0; i < k; i++) x ^= galois_single_multiply(matrix[(erasures[e]-k)*k+i], inverse[i*k+j], w);
+      rows[e*k+j] = x;
+    }
+  }
+  free(decoding);
+  return 0;
+}
+
+//added this function for decoding with the rows from jerasure_make_decoding_rows(). size must be a multiple of w/8.
+
+void jerasure_matrix_decode_with_rows(int k, int w, int *rows, int *src_ids, int *erasures, char **data_ptrs, char **coding_ptrs, int size)
+{
+  int i, e;
+
+  for (e = 0; erasures[e] != -1; e++) {
+    for (i = 0; i < k && rows[e*k+i] == 0; i++) ;
+    if (i == k) { /* jerasure_matrix_dotprod() would leave the device untouched */
+      memset((erasures[e] < k) ? data_ptrs[erasures[e]] : coding_ptrs[erasures[e]-k], 0, size);
+      continue;
+    }
+    jerasure_matrix_dotprod(k, w, rows+e*k, src_ids, erasures[e], data_ptrs, coding_ptrs, size);
+  }
+}
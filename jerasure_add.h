@@ -34,4 +34,80 @@ int **jerasure_generate_decoding_schedule(int k, int m, int w, int *bitmatrix, i
 char **set_up_ptrs_for_scheduled_decoding(int k, int m, int *erasures, char **data_ptrs, char **coding_ptrs);
 // this function is new. It does the same thing just no allocate memery each time
 void jerasure_matrix_to_bitmatrix_noallocate(int k, int m, int w, int *matrix, int *bitmatrix); 
+// this function is new. It decodes with a schedule from jerasure_generate_decoding_schedule, such that the schedule 
+// only needs to be generated once for a given erasure pattern
+int jerasure_schedule_decode_with_schedule(int k, int m, int w, int **schedule, int *erased, char **data_ptrs, char **coding_ptrs, char **ptrs, int size, int packetsize);
+// this function is new. It does the same thing as jerasure_schedule_encode, with the k+m pointers supplied by the caller
+void jerasure_schedule_encode_noallocate(int k, int m, int w, int **schedule, char **data_ptrs, char **coding_ptrs, char **ptrs, int size, int packetsize);
+// this function is new. It does the same as the function above, with a schedule compiled into a function, which is
+// given scratch for its temporary packets
+void jerasure_compiled_encode_noallocate(int k, int m, int w, void (*operations)(char **ptrs, char *temps, int packetsize), char **data_ptrs, char **coding_ptrs, char **ptrs, char *scratch, int size, int packetsize);
+
+/* this is new. A schedule in struct-of-arrays form, in a single block of ints. Consecutive operations of a jerasure
+   schedule that write the same packet are merged into a run: run r sets packet dest_packet[r] of device dest_id[r]
+   to the XOR of the source packets first_src[r] to first_src[r+1]-1, and of its old contents if add[r] is 1.
+   Device temp_id, if num_of_temps is not 0, stands for num_of_temps scratch packets. data is the whole block, size 
+   ints long: num_of_runs, num_of_srcs, max_run, num_of_temps, temp_id, then the six arrays, so that it can be 
+   written to a file and used in place after mapping it back. */
+struct jerasure_flat_schedule {
+  int num_of_runs;
+  int num_of_srcs;
+  int max_run;        /* the most sources of a run */
+  int num_of_temps;
+  int temp_id;        /* -1 without temporaries */
+  int *dest_id;
+  int *dest_packet;
+  int *add;
+  int *first_src;     /* num_of_runs+1 entries */
+  int *src_id;
+  int *src_packet;
+  int *data;
+  int size;
+};
+// these functions are new. They make a flat schedule from a jerasure schedule, whose device temp_id holds 
+// num_of_temps temporary packets (0 for the schedules of Jerasure), or from the data block of one, which is not 
+// copied. Either is freed with jerasure_free_flat_schedule(). A mapped block is refused unless every operation reads
+// and writes packets below w of devices below num_of_devices, or temporaries of device num_of_devices.
+struct jerasure_flat_schedule *jerasure_flatten_schedule(int **schedule, int temp_id, int num_of_temps);
+struct jerasure_flat_schedule *jerasure_map_flat_schedule(int *data, int size, int num_of_devices, int w);
+void jerasure_free_flat_schedule(struct jerasure_flat_schedule *schedule);
+int jerasure_flat_schedule_xors(struct jerasure_flat_schedule *schedule);
+// this function is new. It runs the schedule on count packet groups, the c-th group being stride*c bytes after ptrs,
+// applying each run to all groups before going to the next run. The temporaries of all groups are in ptrs[temp_id].
+void jerasure_do_flat_operations(char **ptrs, struct jerasure_flat_schedule *schedule, int packetsize, int stride, int count);
+// this function is new. It does the same as jerasure_schedule_encode_noallocate() with a flat schedule. If the schedule
+// has temporaries (made by jerasure_optimized_bitmatrix_to_schedule() with temp_id k+m), ptrs has room for k+m+1 
+// pointers and scratch is jerasure_flat_scratch_size() bytes, otherwise scratch is not used.
+int jerasure_flat_scratch_size(int k, int m, int w, struct jerasure_flat_schedule *schedule, int packetsize);
+void jerasure_flat_encode_noallocate(int k, int m, int w, struct jerasure_flat_schedule *schedule, char **data_ptrs, char **coding_ptrs, char **ptrs, char *scratch, int size, int packetsize);
+// this function is new. It does the same as jerasure_schedule_decode_with_schedule() with a flat decoding schedule, 
+// which has no temporaries
+void jerasure_flat_decode_noallocate(int k, int m, int w, struct jerasure_flat_schedule *schedule, int *erased, char **data_ptrs, char **coding_ptrs, char **ptrs, int size, int packetsize);
+// this function is new. It schedules a bitmatrix with fewer XORs than jerasure_smart_bitmatrix_to_schedule(), using 
+// *num_of_temps temporary packets of device k+m. xors, if not NULL, gets the XOR counts of the smart schedule and of 
+// the returned one.
+int **jerasure_optimized_bitmatrix_to_schedule(int k, int m, int w, int *bitmatrix, int *num_of_temps, int *xors);
+
+/* these functions are new. A packed bitmatrix holds the bitmatrix of jerasure_matrix_to_bitmatrix() in 1 bit instead of 
+   1 int: each of its m*w bit rows is JERASURE_PACKED_ROW_WORDS(k,w) words, bit x*w+y of a bit row (source device x, 
+   packet y) being bit (x*w+y)%32 of word (x*w+y)/32. The dotprod and encode routines do what their jerasure_bitmatrix
+   counterparts do, with row the coding device (0 to m-1) of the packed bitmatrix. */
+#define JERASURE_PACKED_ROW_WORDS(k, w) (((k)*(w)+31)/32)
+int jerasure_packed_bitmatrix_words(int k, int m, int w);
+unsigned int *jerasure_matrix_to_packed_bitmatrix(int k, int m, int w, int *matrix);
+void jerasure_packed_bitmatrix_dotprod(int k, int w, unsigned int *bitmatrix, int row, int *src_ids, int dest_id, char **data_ptrs, char **coding_ptrs, int size, int packetsize);
+void jerasure_packed_bitmatrix_encode(int k, int m, int w, unsigned int *bitmatrix, char **data_ptrs, char **coding_ptrs, int size, int packetsize);
+// these two functions are new. They compute rows rows[0..num_rows-1] of a (packed bit)matrix with k columns into dests[r] 
+// (XORed into it if add is set) in one pass over the k sources data_ptrs, a zero row clearing dests[r] if add is not set
+void jerasure_packed_bitmatrix_multi_dotprod(int k, int w, unsigned int *bitmatrix, int *rows, int num_rows, char **data_ptrs, char **dests, int size, int packetsize, int add);
+void jerasure_matrix_multi_dotprod(int k, int w, int *matrix, int *rows, int num_rows, char **data_ptrs, char **dests, int size, int add);
+// these two functions are new, for searching coding matrices with few ones in their bitmatrices. The first returns the
+// ones in the bitmatrix of each element (NULL for w>16), the second the scale, among scale and the inverses of the 
+// nonzero elements, that gives the num elements the fewest ones, which it puts in *cost
+int *jerasure_make_ones_table(int w);
+int jerasure_best_scale(int *elts, int num, int w, int *ones, int scale, int *cost);
+// these two functions are new. They decode with GF(2^w) region multiplication instead of a bitmatrix schedule: 
+// the rows recover every erased device directly from the k devices in src_ids
+int jerasure_make_decoding_rows(int k, int m, int w, int *matrix, int *erasures, int *rows, int *src_ids);
+void jerasure_matrix_decode_with_rows(int k, int w, int *rows, int *src_ids, int *erasures, char **data_ptrs, char **coding_ptrs, int size);
 #endif
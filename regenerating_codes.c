@@ -26,20 +26,37 @@ THIS SOFTWARE IS PROVIDED BY AT&T INTELLECTUAL PROPERTY ''AS IS'' AND ANY EXPRES
 #include <stdlib.h>
 #include <string.h>
 #include <math.h>
+#include <limits.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include "jerasure.h"
 #include "reed_sol.h"
 #include "cauchy.h"
+#include "jerasure_add.h"
 
 #include "regenerating_codes.h"
 
+static int make_runtime_state(struct coding_info *info);
+
+#define TILE_BYTES (1024*1024)	// working set of the decoding tiles if the size of the L2 cache is not known
+#define STREAM_STRIPE_SIZE (4*1024*1024)	// data bytes of the stripes of a stream by default, see init_stream()
 
 int make_coding_matrics(struct coding_info *info)
 {
 	int n,k,d,w;
-	int i,j;
+	int i;
 	int* pointer;
-	int beta;
 
+	info->mapping = NULL;
+	info->mapping_size = 0;
+	// bitmatrices and schedules are built on first use, see get_bitmatrix() and get_schedule()
+	info->bitmatrix = NULL;
+	info->schedule = NULL;
+	info->compiled_array = NULL;
+	info->lambda = NULL;
+	info->num_of_submatrices = 0;
 	switch (info->req.type)
 	{
 		case MBR_PRODUCTMATRIX:
@@ -47,19 +64,21 @@ int make_coding_matrics(struct coding_info *info)
 			d = info->req.d;
 			k = info->req.k;	
 			w = info->req.w;	
-			info->matrix = cauchy_good_general_coding_matrix(d, n-k, w);
+			info->matrix = NULL;
+			if(info->req.low_density)
+				info->matrix = search_MBR_product_matrix(info);
+			if(info->matrix == NULL)
+				info->matrix = cauchy_good_general_coding_matrix(d, n-k, w);
   			if (info->matrix == NULL) {
 				printf("couldn't make coding matrix.\n");
 				return(-1);
 			}
-			info->bitmatrix = jerasure_matrix_to_bitmatrix(d, n-k, w, info->matrix);
-			info->schedule = jerasure_smart_bitmatrix_to_schedule(d, n-k, w,  info->bitmatrix);
 
 			// special for the product matrix based scheme, we need to generate two sub-coding matrices
 			info->num_of_submatrices = 2; 
 			info->submatrix_array = malloc(sizeof(int*)*info->num_of_submatrices);
-			info->subbitmatrix_array = malloc(sizeof(int*)*info->num_of_submatrices);
-			info->subschedule_array = malloc(sizeof(int**)*info->num_of_submatrices);
+			info->subbitmatrix_array = calloc(info->num_of_submatrices,sizeof(unsigned int*));
+			info->subschedule_array = calloc(info->num_of_submatrices,sizeof(struct jerasure_flat_schedule*));
 			info->submatrix_array[0] = malloc(sizeof(int)*(n-k)*k);
 			info->submatrix_array[1] = malloc(sizeof(int)*(n-k)*(d-k));			
 			// now fill the these new matrices			
@@ -67,11 +86,6 @@ int make_coding_matrics(struct coding_info *info)
 				memcpy(info->submatrix_array[0]+i*k,info->matrix+d*i,sizeof(int)*k);
 				memcpy(info->submatrix_array[1]+i*(d-k),info->matrix+d*i+k,sizeof(int)*(d-k));
 			}
-			// generate bitmatrices and schedules
-			info->subbitmatrix_array[0] = jerasure_matrix_to_bitmatrix(k, n-k, w, info->submatrix_array[0]); 
-			info->subschedule_array[0] = jerasure_smart_bitmatrix_to_schedule(k, n-k, w,  info->subbitmatrix_array[0]);
-			info->subbitmatrix_array[1] = jerasure_matrix_to_bitmatrix(d-k, n-k, w, info->submatrix_array[1]);
-			info->subschedule_array[1] = jerasure_smart_bitmatrix_to_schedule(d-k, n-k, w,  info->subbitmatrix_array[1]);			
 			break;
 		case MBR_REPAIRBYTRANSFER:
 			k = info->req.inner_k;
@@ -81,8 +95,6 @@ int make_coding_matrics(struct coding_info *info)
 			if (info->matrix == NULL) {
 				printf("couldn't make coding matrix.\n");
 			}
-			info->bitmatrix = jerasure_matrix_to_bitmatrix(k, n-k, w, info->matrix);
-			info->schedule = jerasure_smart_bitmatrix_to_schedule(k, n-k, w, info->bitmatrix);
 			info->num_of_submatrices = 0;
 			break;
 		case MSR_PRODUCTMATRIX:
@@ -95,59 +107,37 @@ int make_coding_matrics(struct coding_info *info)
 			info->matrix = pointer;
 			if(info->matrix==NULL)
 				return (-1);
-			// the first row is [ 0 0 ... 0 1 0 0 ..], i.e., the row of an extended Vandermonde matrix
-			pointer[k-1] = 1;
-			for(j=0 ; j<k-2; j++)
-				pointer[j] = 0;
-			for(j=k ; j<d ; j++)
-				pointer[j] = 0;
-			// generate the other rows of the encoding matrix 
-			for(i=1 ; i < n; i++){
-				pointer += d;
-				beta = galois_single_multiply(i,i,w);
-				// THE \Delta\Phi part
-				pointer[0] = i;
-				for(j=1;j<k-1;j++)
-					pointer[j] = galois_single_multiply(pointer[j-1],beta,w);								
-				// the \Phi part with the first column of \Delta
-				pointer[k-1] = 1;
-				for(j=k;j<2*k-1;j++)
-					pointer[j] = galois_single_multiply(pointer[j-1],beta,w);
-				// the \Delta part without the first column
-				for(j=2*k-1;j<d;j++)
-					pointer[j] = galois_single_multiply(pointer[j-1],i,w);
-			}			
-			info->bitmatrix = jerasure_matrix_to_bitmatrix(d, n, w, info->matrix);
-			info->schedule = jerasure_smart_bitmatrix_to_schedule(d, n, w, info->bitmatrix);
-
-			info->num_of_submatrices = 4;
+			// row i is made with the evaluation point i, the first row is thus [ 0 0 ... 0 1 0 0 ..], i.e., the row 
+			// of an extended Vandermonde matrix
+			if(!info->req.low_density||search_MSR_product_matrix(pointer,info)<0){
+				for(i=0 ; i < n; i++)
+					make_MSR_product_matrix_row(i, pointer+i*d, k, d, w);
+			}
+
+			info->num_of_submatrices = 5;
 			info->submatrix_array = malloc(sizeof(int*)*info->num_of_submatrices);
-			info->subbitmatrix_array = malloc(sizeof(int*)*info->num_of_submatrices);
-			info->subschedule_array = malloc(sizeof(int**)*info->num_of_submatrices);
+			info->subbitmatrix_array = calloc(info->num_of_submatrices,sizeof(unsigned int*));
+			info->subschedule_array = calloc(info->num_of_submatrices,sizeof(struct jerasure_flat_schedule*));
 			// submatrix0 is the submatrix with the left k columns of the matrix [\Phi \Delta].
 			info->submatrix_array[0] = malloc(sizeof(int)*k*n);
 			for(i=0; i<n;i++)
 				memcpy(info->submatrix_array[0]+i*k,info->matrix+i*d+k-1,sizeof(int)*k);			
-			info->subbitmatrix_array[0] = jerasure_matrix_to_bitmatrix(k, n, w, info->submatrix_array[0]);
-			info->subschedule_array[0] = jerasure_smart_bitmatrix_to_schedule(k, n, w, info->subbitmatrix_array[0]);			
 			// submatrix1 is the submatrix with the columns of the matrix [\Phi \Delta].
 			info->submatrix_array[1] = malloc(sizeof(int)*n*(d-k+1));
 			for(i=0; i<n;i++)
 				memcpy(info->submatrix_array[1]+i*(d-k+1),info->matrix+i*d+k-1,sizeof(int)*(d-k+1));			
-			info->subbitmatrix_array[1] = jerasure_matrix_to_bitmatrix(d-k+1, n, w, info->submatrix_array[1]);
-			info->subschedule_array[1] = jerasure_smart_bitmatrix_to_schedule(d-k+1, n, w, info->subbitmatrix_array[1]);
 			// submatrix2 is the submatrix with the columns of the matrix [\Delta].
 			info->submatrix_array[2] = malloc(sizeof(int)*n*(d-2*k+2));
 			for(i=0; i<n;i++)
 				memcpy(info->submatrix_array[2]+i*(d-2*k+2),info->matrix+i*d+2*k-2,sizeof(int)*(d-2*k+2));			
-			info->subbitmatrix_array[2] = jerasure_matrix_to_bitmatrix(d-2*k+2, n, w, info->submatrix_array[2]);
-			info->subschedule_array[2] = jerasure_smart_bitmatrix_to_schedule(d-2*k+2, n, w, info->subbitmatrix_array[2]);
 			// submatrix3 is the submatrix with the columns of the matrix [\Phi].
 			info->submatrix_array[3] = malloc(sizeof(int)*n*(k-1));
 			for(i=0; i<n;i++)
 				memcpy(info->submatrix_array[3]+i*(k-1),info->matrix+i*d+k-1,sizeof(int)*(k-1));			
-			info->subbitmatrix_array[3] = jerasure_matrix_to_bitmatrix(k-1, n, w, info->submatrix_array[3]);
-			info->subschedule_array[3] = jerasure_smart_bitmatrix_to_schedule(k-1, n, w, info->subbitmatrix_array[3]);
+			// submatrix4 is the systematic generator, from the k(d-k+1) systematic subpackets to the parity subpackets
+			info->submatrix_array[4] = make_MSR_systematic_generator(info);
+			if(info->submatrix_array[4]==NULL)
+				return(-1);
 			break;
 		case SRC:
 			n = info->req.n;
@@ -157,8 +147,6 @@ int make_coding_matrics(struct coding_info *info)
 			if (info->matrix == NULL) {
 				printf("couldn't make coding matrix.\n");
 			}
-  			info->bitmatrix = jerasure_matrix_to_bitmatrix(k, n-k, w, info->matrix);
-			info->schedule = jerasure_smart_bitmatrix_to_schedule(k, n-k, w, info->bitmatrix);
 			info->num_of_submatrices = 0;
 			break;
 		case LRC:
@@ -169,8 +157,6 @@ int make_coding_matrics(struct coding_info *info)
 			if (info->matrix == NULL) {
 				printf("couldn't make coding matrix.\n");
 			}
-			info->bitmatrix = jerasure_matrix_to_bitmatrix(k, n-k, w, info->matrix);
-			info->schedule = jerasure_smart_bitmatrix_to_schedule(k, n-k, w, info->bitmatrix);
 			info->num_of_submatrices = 0;
 			break;
 		case STEINERCODE:
@@ -179,306 +165,2350 @@ int make_coding_matrics(struct coding_info *info)
 			printf("This type of regenerating code is not supported. \n");
 			return(-1);	
 	}
-	return(1);
+	return(make_runtime_state(info));
 }
 
-void cleanup_matrics(struct coding_info *info)
+// the state that is local to a process: caches, workspaces and the compiled schedules
+static struct compiled_schedule_entry** find_compiled_schedules(struct coding_info *info, int num);
+
+static int make_runtime_state(struct coding_info *info)
 {
 	int i;
 
-	if(info->matrix!=NULL)
-		free(info->matrix);
-	if(info->bitmatrix!=NULL)
-		free(info->bitmatrix);
-	if(info->schedule!=NULL)
-		jerasure_free_schedule(info->schedule);
+	// the MSR decoding and repair need \lambda_i, which the search of low-density matrices does not keep equal to i
+	if(info->req.type==MSR_PRODUCTMATRIX&&info->matrix!=NULL){
+		info->lambda = talloc(int, info->req.n);
+		if(info->lambda==NULL)
+			return(-1);
+		for(i=0;i<info->req.n;i++)
+			info->lambda[i] = galois_single_divide(info->matrix[i*info->req.d],info->matrix[i*info->req.d+info->req.k-1],info->req.w);
+	}
+	info->backend = BITMATRIX_BACKEND;
+	info->coded_backend = -1;
+	info->optimize_schedules = 0;
+	info->collapsed_decoding = 0;
+	info->tile_bytes = TILE_BYTES;
+	info->memory_budget = 0;
+#ifdef _SC_LEVEL2_CACHE_SIZE
+	if(sysconf(_SC_LEVEL2_CACHE_SIZE)>0)
+		info->tile_bytes = (int)sysconf(_SC_LEVEL2_CACHE_SIZE);
+#endif
+	info->compiled_array = find_compiled_schedules(info, info->num_of_submatrices+1);
+	// repair coefficients are computed on first use, see get_repair_entry()
+	info->repair_cache = talloc(struct repair_cache, 1);
+	if(info->repair_cache==NULL)
+		return(-1);
+	memset(info->repair_cache,0,sizeof(struct repair_cache));
+	pthread_mutex_init(&info->repair_cache->lock,NULL);
 
-	if(info->num_of_submatrices>0){
-		for(i=0;i<info->num_of_submatrices;i++){
-			free(info->submatrix_array[i]);
-			free(info->subbitmatrix_array[i]);
-			jerasure_free_schedule(info->subschedule_array[i]);
-		}
-		free(info->submatrix_array);
-		free(info->subbitmatrix_array);
-		free(info->subschedule_array);	
+	info->workspace_pool = talloc(struct workspace_pool, 1);
+	if(info->workspace_pool==NULL)
+		return(-1);
+	info->workspace_pool->list = NULL;
+	if(pthread_key_create(&info->workspace_pool->key,NULL)!=0){
+		printf("Can not create the workspace key.\n");
+		free(info->workspace_pool);
+		info->workspace_pool = NULL;
+		return(-1);
 	}
+	pthread_mutex_init(&info->workspace_pool->lock,NULL);
 
+	info->table_lock = talloc(pthread_mutex_t, 1);
+	if(info->table_lock==NULL)
+		return(-1);
+	pthread_mutex_init(info->table_lock,NULL);
+	return(1);
 }
 
-int get_requirement(enum codetype type, struct requirement *req, int n, int k, int d, int w)
+static int get_matrix_size(struct coding_info *info, int index, int *cols, int *rows);
+
+static int* get_coding_matrix(struct coding_info *info, int index)
 {
-	if(n<3||k>=n||k<3)
-	{
-		printf("This type of regenerating code is not supported. \n");
-		return(-1);
+	return(index==0?info->matrix:info->submatrix_array[index-1]);
+}
+
+// packed bitmatrix of the coding matrix (index 0) or of submatrix index-1, built the first time it is asked for.
+// Once built, a table never changes, so it is read without the lock.
+static unsigned int* get_lazy_bitmatrix(struct coding_info *info, int index)
+{
+	int cols, rows;
+	unsigned int **slot = index==0?&info->bitmatrix:info->subbitmatrix_array+index-1;
+	unsigned int *bitmatrix = __atomic_load_n(slot,__ATOMIC_ACQUIRE);
+
+	if(bitmatrix!=NULL)
+		return(bitmatrix);
+	pthread_mutex_lock(info->table_lock);
+	bitmatrix = *slot;
+	if(bitmatrix==NULL&&get_matrix_size(info,index,&cols,&rows)>0){
+		bitmatrix = jerasure_matrix_to_packed_bitmatrix(cols,rows,info->req.w,index==0?info->matrix:info->submatrix_array[index-1]);
+		__atomic_store_n(slot,bitmatrix,__ATOMIC_RELEASE);
 	}
-	switch (type)
-	{
-		case MBR_REPAIRBYTRANSFER: 
-			if(d>=n||k>=d){
-				printf("This type of regenerating code is not supported. \n");
-				return(-1);
-			}
-			req->inner_n = n*(n-1)/2;
-			if((1<<w)<req->inner_n)
-			{
-				printf("invalid w values.\n");
-				return(-1);
-			}
-			req->type = type;
-			req->inner_k = k*n-k*(k+1)/2;
-			req->multiple_of = req->inner_k*ALIGNMENT*w;	
-			req->min_size = req->multiple_of;
-			req->max_size = MIN(req->multiple_of*1024*1024*8,MAXPACKETSIZE);		
-			req->n = n;
-			req->k = k;
-			req->d = n-1;
-			req->w = w;
-			break;						
-		case MSR_PRODUCTMATRIX:
-			if(n<=d||d<2*k-2||d<k||(1<<w)<n||k<=2)
-			{
-				printf("invalid n=%d,k=%d,d=%d,w=%d values.\n",n,k,d,w);	
-				return(-1);
-			}
-			req->n = n;
-			req->k = k;
-			req->d = d;				
-			req->type = type;			
-			req->multiple_of = k*(d-k+1)*ALIGNMENT*w;	
-			req->min_size = req->multiple_of;
-			req->max_size = MIN(req->multiple_of*1024*1024*8,MAXPACKETSIZE);		
-			req->w = w;
-			break;
-		case MBR_PRODUCTMATRIX:
-			req->n = n;
-			req->k = k;
-			req->d = d;	
-			if((1<<w)<req->n)
-			{
-				printf("invalid w values.\n");
-				return(-1);
-			}
-			req->type = type;			
-			req->multiple_of = ((k+1)*k/2+k*(d-k))*ALIGNMENT*w;	
-			req->min_size = req->multiple_of;
-			req->max_size = MIN(req->multiple_of*1024*1024*8,MAXPACKETSIZE);		
-			req->w = w;
-			break;
-		case SRC:
-			req->n = n;
-			req->k = k;
-			req->f = d;			
-			if((1<<w)<n||req->f+1>n)
-			{
-				printf("invalid w values.\n");
-				return(-1);
-			}
-			req->type = type;			
-			req->multiple_of = k*req->f*ALIGNMENT*w;	
-			req->min_size = req->multiple_of;
-			req->max_size = MIN(req->multiple_of*1024*1024*8,MAXPACKETSIZE);		
-			req->d = MIN(2*req->f,n-1);
-			req->w = w;
-			break;	
-		case LRC:	
-			req->n = n;
-			req->k = k;
-			req->f = d;			
-			if((1<<w)<n||req->f+1>n)
-			{
-				printf("invalid w values.\n");
-				return(-1);
-			}
-			req->type = type;			
-			req->multiple_of = k*(req->f)*ALIGNMENT*w;	
-			req->min_size = req->multiple_of;
-			req->max_size = MIN(req->multiple_of*1024*1024*8,MAXPACKETSIZE);		
-			req->d = d;
-			req->w = w;
-			break;		
-		case STEINERCODE:
-		default: 
-			printf("This type of regenerating code is not supported. \n");
-			return(-1);			
+	pthread_mutex_unlock(info->table_lock);
+	if(bitmatrix==NULL)
+		printf("Can not make the coding bitmatrix.\n");
+	return(bitmatrix);
+}
+
+static struct jerasure_flat_schedule* get_lazy_schedule(struct coding_info *info, int index)
+{
+	int cols, rows;
+	struct jerasure_flat_schedule **slot = index==0?&info->schedule:info->subschedule_array+index-1;
+	struct jerasure_flat_schedule *schedule = __atomic_load_n(slot,__ATOMIC_ACQUIRE);
+	int *bitmatrix, **jerasure_schedule;
+	int num_of_temps = 0;
+
+	if(schedule!=NULL)
+		return(schedule);
+	pthread_mutex_lock(info->table_lock);
+	schedule = *slot;
+	if(schedule==NULL&&get_matrix_size(info,index,&cols,&rows)>0){
+		// Jerasure needs the unpacked bitmatrix, which is only kept while the schedule is made
+		bitmatrix = jerasure_matrix_to_bitmatrix(cols,rows,info->req.w,index==0?info->matrix:info->submatrix_array[index-1]);
+		if(bitmatrix==NULL)
+			jerasure_schedule = NULL;
+		else if(info->optimize_schedules)
+			jerasure_schedule = jerasure_optimized_bitmatrix_to_schedule(cols,rows,info->req.w,bitmatrix,&num_of_temps,NULL);
+		else
+			jerasure_schedule = jerasure_smart_bitmatrix_to_schedule(cols,rows,info->req.w,bitmatrix);
+		schedule = jerasure_flatten_schedule(jerasure_schedule,cols+rows,num_of_temps);
+		if(jerasure_schedule!=NULL)
+			jerasure_free_schedule(jerasure_schedule);
+		if(bitmatrix!=NULL)
+			free(bitmatrix);
+		__atomic_store_n(slot,schedule,__ATOMIC_RELEASE);
 	}
-		
-	return(req->multiple_of);
+	pthread_mutex_unlock(info->table_lock);
+	if(schedule==NULL)
+		printf("Can not make the coding schedule.\n");
+	return(schedule);
 }
 
-int compute_coded_packet_size(struct requirement *req, int data_size)
+unsigned int* get_bitmatrix(struct coding_info *info)
 {
-	int packet_size=-1;		
-	switch (req->type)
-	{
-		case MBR_REPAIRBYTRANSFER: 
-			packet_size = data_size/req->inner_k*(req->n-1);	         
-			break;					
-		case MSR_PRODUCTMATRIX:
-			packet_size = data_size/(req->k);
-			break;
-		case MBR_PRODUCTMATRIX:
-			packet_size = data_size/((req->k+1)*req->k/2+req->k*(req->d-req->k))*req->d;			
-			break;
-		case SRC:
-			packet_size = data_size/(req->k*req->f)*(req->f+1);
-			break;
-		case LRC:
-			packet_size = data_size/(req->k*req->f)*(req->f+1);
-			break;			
-		case STEINERCODE:
-		default: 
-			printf("This type of regenerating code is not supported. \n");
-			return(-1);			
-	}	
-	return(packet_size);
+	return(get_lazy_bitmatrix(info,0));
 }
 
-int compute_repair_packet_size(struct requirement *req, int data_size)
+struct jerasure_flat_schedule* get_schedule(struct coding_info *info)
 {
-	int packet_size=-1;		
-	switch (req->type)
-	{
-		case MBR_REPAIRBYTRANSFER: 
-			packet_size = data_size/req->inner_k;	         
-			break;					
-		case MSR_PRODUCTMATRIX:
-			packet_size = data_size/(req->k*(req->d-req->k+1));
-			break;
-		case MBR_PRODUCTMATRIX:
-			packet_size = data_size/((req->k+1)*req->k/2+req->k*(req->d-req->k));
-			break;
-		case SRC:
-			packet_size = data_size/(req->k*(req->f))*(req->f+1);
-			break;
-		case LRC:
-			packet_size = data_size/(req->k*(req->f))*(req->f+1);
-			break;
-		case STEINERCODE:
-		default: 
-			printf("This type of regenerating code is not supported. \n");
-			return(-1);			
-	}	
-	return(packet_size);
+	return(get_lazy_schedule(info,0));
 }
-/*
-int checkValid(size_t inputsize, size_t outputsize, int packetsize, struct Requirement *requirement, int w)
+
+unsigned int* get_subbitmatrix(struct coding_info *info, int index)
 {
+	return(get_lazy_bitmatrix(info,index+1));
+}
 
-	size_t wordsize = w/8;		
-	if(inputsize/(wordsize*req->multipleof)!=0||inputsize>req->maxSize*wordsize||inputsize<req->maxSize*wordsize)
-	{
-		printf("In correct input packet size. \n");
+struct jerasure_flat_schedule* get_subschedule(struct coding_info *info, int index)
+{
+	return(get_lazy_schedule(info,index+1));
+}
+
+// FNV-1a hash of the coding matrix, which determines all the schedules of a configuration
+unsigned int get_matrix_hash(struct coding_info *info)
+{
+	int i, cols, rows;
+	unsigned int hash = 2166136261u;
+
+	if(info->matrix==NULL||get_matrix_size(info,0,&cols,&rows)<0)
+		return(0);
+	for(i=0;i<cols*rows;i++){
+		hash ^= (unsigned int)info->matrix[i];
+		hash *= 16777619u;
+	}
+	return(hash);
+}
+
+// looks up the compiled schedules of this configuration in the registry, made by schedule_compiler at build time.
+// Returns NULL if none of the num schedules is compiled.
+static struct compiled_schedule_entry** find_compiled_schedules(struct coding_info *info, int num)
+{
+	int found = 0;
+	unsigned int hash = get_matrix_hash(info);
+	struct compiled_schedule_entry *entry;
+	struct compiled_schedule_entry **array = calloc(num,sizeof(struct compiled_schedule_entry*));
+
+	if(array==NULL)
+		return(NULL);
+	for(entry=compiled_schedules;entry->function!=NULL;entry++){
+		if(entry->type==info->req.type&&entry->n==info->req.n&&entry->k==info->req.k&&entry->d==info->req.d
+			&&entry->w==info->req.w&&entry->matrix_hash==hash&&entry->index>=0&&entry->index<num){
+			array[entry->index] = entry;
+			found = 1;
+		}
+	}
+	if(found==0){
+		free(array);
+		return(NULL);
+	}
+	return(array);
+}
+
+// selects how the regions are coded. The backends give different coded data, so the backend is fixed by the first
+// encoding, decoding or repair with info, or by the file info was loaded from (see save_coding_info()), and can not 
+// be changed afterwards. Plans keep the backend they were made with, and are refused by the decoding once it is 
+// another one. Not to be called while info is being used by other threads.
+int set_coding_backend(struct coding_info *info, enum coding_backend backend)
+{
+	int w = info->req.w;
+
+	if(backend==MATRIX_BACKEND&&w!=8&&w!=16&&w!=32){
+		printf("The matrix backend needs w=8, 16 or 32.\n");
 		return(-1);
 	}
+	if(info->coded_backend>=0&&info->coded_backend!=(int)backend){
+		printf("The data of this code is coded with the other backend.\n");
+		return(-1);
+	}
+	info->backend = backend;
 	return(1);
-	
-}*/
+}
 
-int encode_rc(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info)
+// called by every coding: fixes the backend of info if it is the first one, and checks that the plan, if any, was
+// made with it
+static int use_backend(struct coding_info *info, struct decode_plan *plan)
 {
-	switch (info->req.type)
-	{
-		case MBR_REPAIRBYTRANSFER: 			
-			encode_MBR_repair_by_transfer(input, input_size, output, output_size, info);
-			break;						
-		case MSR_PRODUCTMATRIX:
-			encode_MSR_product_matrix(input, input_size, output, output_size, info);
-			break;						
-		case MBR_PRODUCTMATRIX:
-			encode_MBR_product_matrix(input, input_size, output, output_size, info);
-			break;								
-		case SRC:
-			encode_SRC(input, input_size, output, output_size, info);
-			break;
-		case LRC:
-			encode_LRC(input, input_size, output, output_size, info);
-			break;
-		case STEINERCODE:
-		default: 
-			printf("This type of regenerating code is not supported. \n");
-			return(-1);			
+	if(plan!=NULL&&plan->backend!=info->backend){
+		printf("The decode plan was made with another coding backend.\n");
+		return(-1);
 	}
-	return(1);	
+	if(__atomic_load_n(&info->coded_backend,__ATOMIC_RELAXED)<0)
+		__atomic_store_n(&info->coded_backend,(int)info->backend,__ATOMIC_RELAXED);
+	return(1);
 }
-int decode_rc(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info)
+
+// schedules the bitmatrices with jerasure_optimized_bitmatrix_to_schedule() (optimize=1), which takes much longer than
+// the smart schedules of Jerasure (optimize=0) but saves XORs in every encoding. Only affects the schedules that have 
+// not been built yet, so it is called right after make_coding_matrics(). Not to be called while info is being used 
+// by other threads.
+void set_schedule_optimization(struct coding_info *info, int optimize)
 {
-	switch (info->req.type)
-	{
-		case MBR_REPAIRBYTRANSFER: 			
-			decode_MBR_repair_by_transfer(input, input_size, output, output_size, erasures, info);
-			break;						
-		case MSR_PRODUCTMATRIX:
-			decode_MSR_product_matrix(input, input_size, output, output_size, erasures, info);
-			break;						
-		case MBR_PRODUCTMATRIX:
-			decode_MBR_product_matrix(input, input_size, output, output_size, erasures, info);
-			break;								
-		case SRC:
-			decode_SRC(input, input_size, output, output_size, erasures, info);
-			break;
-		case LRC:
-			decode_LRC(input, input_size, output, output_size, erasures, info);
-			break;
-		case STEINERCODE:
-		default: 
-			printf("This type of regenerating code is not supported. \n");
-			return(-1);			
+	info->optimize_schedules = optimize;
+}
+
+// decodes with plans made from now on by one linear map from the remaining devices to the erased data (collapse=1) 
+// instead of the phases of the code, for the codes that support it (MSR product-matrix). The map is derived when 
+// the plan is made, which takes longer, and is scheduled like the coding matrices. Unlike the phases, which rebuild
+// the erased devices in their input buffers on the way, the map only writes the output: the buffers of the erased 
+// devices are left as they were, apart from the subpackets that an iov decoding places there (NULL output[j]).
+// Not to be called while info is being used by other threads.
+void set_collapsed_decoding(struct coding_info *info, int collapse)
+{
+	info->collapsed_decoding = collapse;
+}
+
+// the XORs done per packet group by the schedule of matrix index, and in unoptimized, by the smart schedule of Jerasure
+int get_schedule_xors(struct coding_info *info, int index, int *unoptimized)
+{
+	int cols, rows, *bitmatrix, **schedule;
+	struct jerasure_flat_schedule *flat = get_lazy_schedule(info,index);
+
+	if(flat==NULL||get_matrix_size(info,index,&cols,&rows)<0)
+		return(-1);
+	bitmatrix = jerasure_matrix_to_bitmatrix(cols,rows,info->req.w,get_coding_matrix(info,index));
+	schedule = bitmatrix==NULL?NULL:jerasure_smart_bitmatrix_to_schedule(cols,rows,info->req.w,bitmatrix);
+	if(bitmatrix!=NULL)
+		free(bitmatrix);
+	if(schedule==NULL){
+		printf("Can not make the coding schedule.\n");
+		return(-1);
 	}
-	return(1);	
+	for(*unoptimized=0,cols=0;schedule[cols][0]>=0;cols++)
+		*unoptimized += schedule[cols][4];
+	jerasure_free_schedule(schedule);
+	return(jerasure_flat_schedule_xors(flat));
 }
-int repair_encode_rc(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info)
+
+
+// an optimized schedule needs one more pointer and the scratch packets of its temporaries
+static int encode_by_flat_schedule(struct jerasure_flat_schedule *schedule, int k, int m, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info)
 {
-	switch (info->req.type)
-	{
-		case MBR_REPAIRBYTRANSFER: 			
-			repair_encode_MBR_repair_by_transfer(input, input_size, output, output_size, from_device_ID, to_device_ID, info);
+	struct workspace *ws;
+	size_t mark;
+	char **temp_ptrs, *scratch;
+
+	if(schedule==NULL)
+		return(-1);
+	if(schedule->num_of_temps==0){
+		jerasure_flat_encode_noallocate(k,m,info->req.w,schedule,data_ptrs,coding_ptrs,ptrs,NULL,length,ALIGNMENT);
+		return(1);
+	}
+	ws = get_workspace(info);
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	temp_ptrs = workspace_alloc(ws, sizeof(char*)*(k+m+1));
+	scratch = workspace_alloc(ws, jerasure_flat_scratch_size(k,m,info->req.w,schedule,ALIGNMENT));
+	if(temp_ptrs==NULL||scratch==NULL){
+		printf("Out of memory.\n");
+		workspace_release(ws, mark);
+		return(-1);
+	}
+	jerasure_flat_encode_noallocate(k,m,info->req.w,schedule,data_ptrs,coding_ptrs,temp_ptrs,scratch,length,ALIGNMENT);
+	workspace_release(ws, mark);
+	return(1);
+}
+
+// the temporaries of a compiled schedule are in the workspace, like those of an interpreted one
+static int encode_by_compiled_schedule(struct compiled_schedule_entry *compiled, int k, int m, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info)
+{
+	struct workspace *ws;
+	size_t mark;
+	char *scratch;
+
+	if(compiled->num_of_temps==0){
+		jerasure_compiled_encode_noallocate(k,m,info->req.w,compiled->function,data_ptrs,coding_ptrs,ptrs,NULL,length,ALIGNMENT);
+		return(1);
+	}
+	ws = get_workspace(info);
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	scratch = workspace_alloc(ws, (size_t)compiled->num_of_temps*ALIGNMENT);
+	if(scratch==NULL){
+		printf("Out of memory.\n");
+		workspace_release(ws, mark);
+		return(-1);
+	}
+	jerasure_compiled_encode_noallocate(k,m,info->req.w,compiled->function,data_ptrs,coding_ptrs,ptrs,scratch,length,ALIGNMENT);
+	workspace_release(ws, mark);
+	return(1);
+}
+
+int encode_by_matrix(int index, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info)
+{
+	int cols, rows;
+
+	get_matrix_size(info,index,&cols,&rows);
+	if(info->backend==MATRIX_BACKEND)
+		jerasure_matrix_encode(cols,rows,info->req.w,get_coding_matrix(info,index),data_ptrs,coding_ptrs,length);
+	else if(info->compiled_array!=NULL&&info->compiled_array[index]!=NULL)
+		return(encode_by_compiled_schedule(info->compiled_array[index],cols,rows,data_ptrs,coding_ptrs,ptrs,length,info));
+	else
+		return(encode_by_flat_schedule(get_lazy_schedule(info,index),cols,rows,data_ptrs,coding_ptrs,ptrs,length,info));
+	return(1);
+}
+
+// dest = row of the matrix times data_ptrs. Like the Jerasure dotprods, dest is left untouched if the row is all zero.
+void dotprod_by_matrix(int index, int row, char **data_ptrs, char *dest, int length, struct coding_info *info)
+{
+	int cols, rows;
+	int w = info->req.w;
+
+	get_matrix_size(info,index,&cols,&rows);
+	if(info->backend==MATRIX_BACKEND)
+		jerasure_matrix_dotprod(cols,w,get_coding_matrix(info,index)+row*cols,NULL,cols,data_ptrs,&dest,length);
+	else
+		jerasure_packed_bitmatrix_dotprod(cols,w,get_lazy_bitmatrix(info,index),row,NULL,cols,data_ptrs,&dest,length,ALIGNMENT);
+}
+
+// dests[r] = row rows[r] of the matrix times data_ptrs, or dests[r] ^= it if add is 1, reading data_ptrs once for all
+// the rows. Unlike dotprod_by_matrix(), a zero row clears dests[r] when add is 0.
+void dotprod_rows_by_matrix(int index, int *rows, int num_rows, char **data_ptrs, char **dests, int length, int add, struct coding_info *info)
+{
+	int cols, rows_of_matrix;
+	int w = info->req.w;
+
+	get_matrix_size(info,index,&cols,&rows_of_matrix);
+	if(info->backend==MATRIX_BACKEND)
+		jerasure_matrix_multi_dotprod(cols,w,get_coding_matrix(info,index),rows,num_rows,data_ptrs,dests,length,add);
+	else
+		jerasure_packed_bitmatrix_multi_dotprod(cols,w,get_lazy_bitmatrix(info,index),rows,num_rows,data_ptrs,dests,length,ALIGNMENT,add);
+}
+
+// codes with the (k,m) repair matrix of entry
+void encode_by_entry(struct repair_entry *entry, int k, int m, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info)
+{
+	if(info->backend==MATRIX_BACKEND||entry->schedule==NULL)
+		jerasure_matrix_encode(k,m,info->req.w,entry->matrix,data_ptrs,coding_ptrs,length);
+	else
+		jerasure_schedule_encode_noallocate(k,m,info->req.w,entry->schedule,data_ptrs,coding_ptrs,ptrs,length,ALIGNMENT);
+}
+
+// sets the working set, in bytes, of the tiles that a decoder with several phases (MSR product-matrix) runs all its 
+// phases on before going to the next tile, so that the intermediate results stay in the cache instead of going to 
+// memory and back after each phase. The default is the size of the L2 cache; 0 runs each phase on whole subpackets. 
+// Not to be called while info is being used by other threads.
+void set_tile_bytes(struct coding_info *info, int bytes)
+{
+	info->tile_bytes = bytes;
+}
+
+// caps the scratch memory for the stripe data that MSR product-matrix decoding takes from the workspace of a thread
+// at bytes, whatever the size of the stripes: it then works on tiles of the subpackets small enough for their scratch
+// to fit, see set_tile_bytes(); in a read-only decoding, that includes the erased parity devices, which are rebuilt
+// in scratch. A decoding fails if the budget does not hold the scratch of one packet. Encoding, whose
+// scratch does not grow with the stripes, and collapsed decoding, which has none, are not limited. 0, the default,
+// sets no limit. Set it right after make_coding_matrics(), as a workspace keeps the largest scratch it has held; not
+// to be called while info is being used by other threads.
+void set_memory_budget(struct coding_info *info, long long bytes)
+{
+	info->memory_budget = bytes;
+}
+
+// bytes of each subpacket in one tile of a coding that touches bytes_per_byte bytes, scratch_per_byte of them in
+// scratch memory, per byte of subpacket: a whole number of packets, or length if tiling is off or the subpackets are
+// not made of whole packets, and small enough for the memory budget. 0 if no tile fits in the budget.
+int get_tile_length(struct coding_info *info, int length, int bytes_per_byte, int scratch_per_byte)
+{
+	int packet_size = ALIGNMENT*info->req.w;
+	int tile = length;
+	long long budget = info->memory_budget;
+
+	if(length<=0)
+		return(length);
+	if(length%packet_size==0){
+		if(info->tile_bytes>0)
+			tile = MAX(info->tile_bytes/bytes_per_byte/packet_size,1)*packet_size;
+		if(budget>0&&scratch_per_byte>0)
+			tile = MIN(tile,budget/scratch_per_byte/packet_size*packet_size);
+	}
+	else if(budget>0&&(long long)length*scratch_per_byte>budget)
+		tile = 0;
+	if(tile==0)
+		printf("The memory budget is too small.\n");
+	return(MIN(tile,length));
+}
+
+// makes schedule schedule_index of the plan (the decoding rows with the matrix backend), which decodes erasures of the 
+// code of matrix index. The arrays of the plan with num_of_schedules entries must have been allocated.
+int make_plan_decoding(struct decode_plan *plan, int schedule_index, int index, int *erasures, struct coding_info *info)
+{
+	int cols, rows;
+
+	if(get_matrix_size(info,index,&cols,&rows)<0)
+		return(-1);
+	return(make_plan_decoding_by_matrix(plan,schedule_index,get_coding_matrix(info,index),cols,rows,erasures,info));
+}
+
+static int alloc_plan_matrices(struct decode_plan *plan)
+{
+	if(plan->matrix_array==NULL){
+		plan->matrix_array = calloc(plan->num_of_schedules,sizeof(int*));
+		plan->src_ids_array = calloc(plan->num_of_schedules,sizeof(int*));
+	}
+	if(plan->matrix_array==NULL||plan->src_ids_array==NULL){
+		printf("Can not allocate memory\n");
+		return(-1);
+	}
+	return(1);
+}
+
+// the same as make_plan_decoding() for a (cols,rows) code of the given matrix, which is copied
+int make_plan_decoding_by_matrix(struct decode_plan *plan, int schedule_index, int *matrix, int cols, int rows, int *erasures, struct coding_info *info)
+{
+	int i;
+	int *bitmatrix, **jerasure_schedule;
+
+	if(plan->backend==MATRIX_BACKEND){
+		for(i=0;erasures[i]!=-1;i++);
+		if(alloc_plan_matrices(plan)<0
+			||(plan->matrix_array[schedule_index] = talloc(int, (i+1)*cols))==NULL
+			||(plan->src_ids_array[schedule_index] = talloc(int, cols))==NULL){
+			printf("Can not allocate memory\n");
+			return(-1);
+		}
+		if(jerasure_make_decoding_rows(cols,rows,info->req.w,matrix,erasures,
+			plan->matrix_array[schedule_index],plan->src_ids_array[schedule_index])<0){
+			printf("Can not make the decoding matrix.\n");
+			return(-1);
+		}
+		return(1);
+	}
+	// the packed bitmatrix of info can not be given to Jerasure
+	bitmatrix = jerasure_matrix_to_bitmatrix(cols,rows,info->req.w,matrix);
+	if(bitmatrix==NULL){
+		printf("Can not allocate memory\n");
+		return(-1);
+	}
+	jerasure_schedule = jerasure_generate_decoding_schedule(cols,rows,info->req.w,bitmatrix,erasures,1);
+	free(bitmatrix);
+	plan->schedule_array[schedule_index] = jerasure_flatten_schedule(jerasure_schedule,cols+rows,0);
+	if(jerasure_schedule!=NULL)
+		jerasure_free_schedule(jerasure_schedule);
+	if(plan->schedule_array[schedule_index]==NULL){
+		printf("Can not generate decoding schedule.\n");
+		return(-1);
+	}
+	return(1);
+}
+
+// makes schedule schedule_index of the plan code with the rows-by-cols matrix, a small matrix that only depends on the
+// erasures, e.g., a solve step of a decoder. With the matrix backend, matrix_array[schedule_index] is a copy of it.
+int make_plan_encoding(struct decode_plan *plan, int schedule_index, int *matrix, int cols, int rows, struct coding_info *info)
+{
+	int *bitmatrix, **jerasure_schedule;
+
+	if(plan->backend==MATRIX_BACKEND){
+		if(alloc_plan_matrices(plan)<0||(plan->matrix_array[schedule_index] = talloc(int, cols*rows))==NULL){
+			printf("Can not allocate memory\n");
+			return(-1);
+		}
+		memcpy(plan->matrix_array[schedule_index],matrix,sizeof(int)*cols*rows);
+		return(1);
+	}
+	bitmatrix = jerasure_matrix_to_bitmatrix(cols,rows,info->req.w,matrix);
+	if(bitmatrix==NULL){
+		printf("Can not allocate memory\n");
+		return(-1);
+	}
+	jerasure_schedule = jerasure_smart_bitmatrix_to_schedule(cols,rows,info->req.w,bitmatrix);
+	free(bitmatrix);
+	plan->schedule_array[schedule_index] = jerasure_flatten_schedule(jerasure_schedule,cols+rows,0);
+	if(jerasure_schedule!=NULL)
+		jerasure_free_schedule(jerasure_schedule);
+	if(plan->schedule_array[schedule_index]==NULL){
+		printf("Can not make the coding schedule.\n");
+		return(-1);
+	}
+	return(1);
+}
+
+// codes with schedule schedule_index of the plan made by make_plan_encoding()
+void encode_by_plan(struct decode_plan *plan, int schedule_index, int k, int m, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info)
+{
+	if(plan->backend==MATRIX_BACKEND)
+		jerasure_matrix_encode(k,m,info->req.w,plan->matrix_array[schedule_index],data_ptrs,coding_ptrs,length);
+	else
+		jerasure_flat_encode_noallocate(k,m,info->req.w,plan->schedule_array[schedule_index],data_ptrs,coding_ptrs,ptrs,NULL,length,ALIGNMENT);
+}
+
+void decode_by_plan(struct decode_plan *plan, int schedule_index, int k, int m, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info)
+{
+	int *erasures = plan->erasures_array[schedule_index];
+	int *erased = plan->erased_array!=NULL?plan->erased_array[schedule_index]:NULL;
+
+	if(plan->backend==MATRIX_BACKEND)
+		jerasure_matrix_decode_with_rows(k,info->req.w,plan->matrix_array[schedule_index],plan->src_ids_array[schedule_index],
+			erasures!=NULL?erasures:plan->erasures,data_ptrs,coding_ptrs,length);
+	else
+		jerasure_flat_decode_noallocate(k,m,info->req.w,plan->schedule_array[schedule_index],erased!=NULL?erased:plan->erased,
+			data_ptrs,coding_ptrs,ptrs,length,ALIGNMENT);
+}
+
+// makes the plan decode by matrix, a rows-by-cols map from the subpackets of the remaining devices to the erased
+// subpackets. The plan takes matrix, which is malloc()ed.
+int make_plan_collapsed(struct decode_plan *plan, int *matrix, int cols, int rows, struct coding_info *info)
+{
+	int *bitmatrix, **jerasure_schedule;
+	int num_of_temps = 0;
+
+	plan->collapsed_cols = cols;
+	plan->collapsed_rows = rows;
+	plan->collapsed_matrix = matrix;
+	if(plan->backend==MATRIX_BACKEND||rows==0)
+		return(1);
+	bitmatrix = jerasure_matrix_to_bitmatrix(cols,rows,info->req.w,matrix);
+	if(bitmatrix==NULL)
+		jerasure_schedule = NULL;
+	else if(info->optimize_schedules)
+		jerasure_schedule = jerasure_optimized_bitmatrix_to_schedule(cols,rows,info->req.w,bitmatrix,&num_of_temps,NULL);
+	else
+		jerasure_schedule = jerasure_smart_bitmatrix_to_schedule(cols,rows,info->req.w,bitmatrix);
+	plan->collapsed_schedule = jerasure_flatten_schedule(jerasure_schedule,cols+rows,num_of_temps);
+	if(jerasure_schedule!=NULL)
+		jerasure_free_schedule(jerasure_schedule);
+	if(bitmatrix!=NULL)
+		free(bitmatrix);
+	if(plan->collapsed_schedule==NULL){
+		printf("Can not generate decoding schedule.\n");
+		return(-1);
+	}
+	return(1);
+}
+
+// coding_ptrs = the collapsed map of the plan times data_ptrs, ptrs having room for collapsed_cols+collapsed_rows+1 pointers
+int decode_by_collapsed_plan(struct decode_plan *plan, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info)
+{
+	if(plan->collapsed_rows==0)
+		return(1);
+	if(plan->backend==MATRIX_BACKEND){
+		jerasure_matrix_encode(plan->collapsed_cols,plan->collapsed_rows,info->req.w,plan->collapsed_matrix,data_ptrs,coding_ptrs,length);
+		return(1);
+	}
+	return(encode_by_flat_schedule(plan->collapsed_schedule,plan->collapsed_cols,plan->collapsed_rows,data_ptrs,coding_ptrs,ptrs,length,info));
+}
+
+static void free_workspace(struct workspace *ws)
+{
+	struct workspace_chunk *chunk;
+
+	while(ws->overflow!=NULL){
+		chunk = ws->overflow;
+		ws->overflow = chunk->next;
+		free(chunk);
+	}
+	if(ws->buffer!=NULL)
+		free(ws->buffer);
+	free(ws);
+}
+
+// returns the workspace of the calling thread, which is created on first use and kept until 
+// cleanup_matrics() or release_workspace()
+struct workspace* get_workspace(struct coding_info *info)
+{
+	struct workspace_pool *pool = info->workspace_pool;
+	struct workspace *ws = pthread_getspecific(pool->key);
+
+	if(ws!=NULL)
+		return(ws);
+	ws = talloc(struct workspace, 1);
+	if(ws==NULL){
+		printf("Can not allocate memory\n");
+		return(NULL);
+	}
+	memset(ws,0,sizeof(struct workspace));
+	if(pthread_setspecific(pool->key,ws)!=0){
+		free(ws);
+		return(NULL);
+	}
+	pthread_mutex_lock(&pool->lock);
+	ws->next = pool->list;
+	pool->list = ws;
+	pthread_mutex_unlock(&pool->lock);
+	return(ws);
+}
+
+// frees the workspace of the calling thread, for threads that stop using info before it is cleaned up
+void release_workspace(struct coding_info *info)
+{
+	struct workspace_pool *pool = info->workspace_pool;
+	struct workspace *ws = pthread_getspecific(pool->key);
+	struct workspace **pos;
+
+	if(ws==NULL)
+		return;
+	pthread_mutex_lock(&pool->lock);
+	for(pos=&pool->list;*pos!=ws;pos=&(*pos)->next);
+	*pos = ws->next;
+	pthread_mutex_unlock(&pool->lock);
+	pthread_setspecific(pool->key,NULL);
+	free_workspace(ws);
+}
+
+void* workspace_alloc(struct workspace *ws, size_t size)
+{
+	void *p;
+	struct workspace_chunk *chunk;
+
+	size = (size+WORKSPACE_ALIGNMENT-1)/WORKSPACE_ALIGNMENT*WORKSPACE_ALIGNMENT;
+	if(ws->used+size<=ws->size){
+		p = ws->buffer+ws->used;
+		ws->used += size;
+	}
+	else{ // does not fit, until the buffer is enlarged in workspace_release()
+		if(posix_memalign(&p,WORKSPACE_ALIGNMENT,WORKSPACE_ALIGNMENT+size)!=0)
+			return(NULL);
+		chunk = p;
+		chunk->mark = ws->used;
+		chunk->next = ws->overflow;
+		ws->overflow = chunk;
+		p = (char*)p+WORKSPACE_ALIGNMENT;
+		ws->used += size;
+	}
+	ws->peak = MAX(ws->peak,ws->used);
+	return(p);
+}
+
+// the bytes handed out and not given back yet, in the buffer and in separate chunks
+size_t workspace_mark(struct workspace *ws)
+{
+	return(ws->used);
+}
+
+// gives back everything allocated from ws since mark was taken
+void workspace_release(struct workspace *ws, size_t mark)
+{
+	struct workspace_chunk *chunk;
+	void *p;
+
+	while(ws->overflow!=NULL&&ws->overflow->mark>=mark){
+		chunk = ws->overflow;
+		ws->overflow = chunk->next;
+		free(chunk);
+	}
+	ws->used = mark;
+	if(ws->used==0&&ws->peak>ws->size){
+		if(ws->buffer!=NULL)
+			free(ws->buffer);
+		ws->buffer = NULL;
+		ws->size = 0;
+		if(posix_memalign(&p,WORKSPACE_ALIGNMENT,ws->peak)==0){
+			ws->buffer = p;
+			ws->size = ws->peak;
+		}
+	}
+}
+
+static void free_repair_entry(struct repair_entry *entry)
+{
+	if(entry->helpers!=NULL)
+		free(entry->helpers);
+	if(entry->matrix!=NULL)
+		free(entry->matrix);
+	if(entry->bitmatrix!=NULL)
+		free(entry->bitmatrix);
+	if(entry->schedule!=NULL)
+		jerasure_free_schedule(entry->schedule);
+	free(entry);
+}
+
+void cleanup_matrics(struct coding_info *info)
+{
+	int i;
+	struct workspace *ws;
+
+	if(info->repair_cache!=NULL){
+		for(i=0;i<info->repair_cache->num_of_entries;i++)
+			free_repair_entry(info->repair_cache->entries[i]);
+		pthread_mutex_destroy(&info->repair_cache->lock);
+		free(info->repair_cache);
+		info->repair_cache = NULL;
+	}
+	if(info->workspace_pool!=NULL){
+		while(info->workspace_pool->list!=NULL){
+			ws = info->workspace_pool->list;
+			info->workspace_pool->list = ws->next;
+			free_workspace(ws);
+		}
+		pthread_key_delete(info->workspace_pool->key);
+		pthread_mutex_destroy(&info->workspace_pool->lock);
+		free(info->workspace_pool);
+		info->workspace_pool = NULL;
+	}
+	if(info->table_lock!=NULL){
+		pthread_mutex_destroy(info->table_lock);
+		free(info->table_lock);
+		info->table_lock = NULL;
+	}
+	if(info->compiled_array!=NULL){
+		free(info->compiled_array);
+		info->compiled_array = NULL;
+	}
+	if(info->lambda!=NULL){
+		free(info->lambda);
+		info->lambda = NULL;
+	}
+	if(info->mapping!=NULL){ // only the schedule headers and pointer arrays are allocated, the rest is in the mapping
+		if(info->schedule!=NULL)
+			jerasure_free_flat_schedule(info->schedule);
+		if(info->subschedule_array!=NULL){
+			for(i=0;i<info->num_of_submatrices;i++){
+				if(info->subschedule_array[i]!=NULL)
+					jerasure_free_flat_schedule(info->subschedule_array[i]);
+			}
+		}
+		free(info->submatrix_array);
+		free(info->subbitmatrix_array);
+		free(info->subschedule_array);
+		munmap(info->mapping,info->mapping_size);
+		info->mapping = NULL;
+		return;
+	}
+
+	if(info->matrix!=NULL)
+		free(info->matrix);
+	if(info->bitmatrix!=NULL)
+		free(info->bitmatrix);
+	if(info->schedule!=NULL)
+		jerasure_free_flat_schedule(info->schedule);
+
+	if(info->num_of_submatrices>0){
+		for(i=0;i<info->num_of_submatrices;i++){
+			free(info->submatrix_array[i]);
+			if(info->subbitmatrix_array[i]!=NULL)
+				free(info->subbitmatrix_array[i]);
+			if(info->subschedule_array[i]!=NULL)
+				jerasure_free_flat_schedule(info->subschedule_array[i]);
+		}
+		free(info->submatrix_array);
+		free(info->subbitmatrix_array);
+		free(info->subschedule_array);	
+	}
+
+}
+
+static struct repair_entry* find_repair_entry(int to_device_ID, int* helpers, struct coding_info *info)
+{
+	int i;
+	struct repair_cache *cache = info->repair_cache;
+	for(i=0;i<cache->num_of_entries;i++){
+		if(cache->entries[i]->to_device_ID==to_device_ID
+			&&memcmp(cache->entries[i]->helpers,helpers,sizeof(int)*info->req.d)==0)
+			return(cache->entries[i]);
+	}
+	return(NULL);
+}
+
+// returns the repair entry for the newcomer to_device_ID and the d helpers, computing it with make_entry
+// if it is not cached yet. Every entry obtained here must be given back with put_repair_entry.
+struct repair_entry* get_repair_entry(int to_device_ID, int* helpers, struct coding_info *info,
+	int (*make_entry)(struct repair_entry *entry, struct coding_info *info))
+{
+	int i, victim;
+	int d = info->req.d;
+	struct repair_cache *cache = info->repair_cache;
+	struct repair_entry *entry, *found;
+
+	pthread_mutex_lock(&cache->lock);
+	entry = find_repair_entry(to_device_ID, helpers, info);
+	if(entry!=NULL){
+		entry->refs++;
+		entry->last_used = ++cache->clock;
+		pthread_mutex_unlock(&cache->lock);
+		return(entry);
+	}
+	pthread_mutex_unlock(&cache->lock);
+
+	// not cached: compute it without holding the lock
+	entry = talloc(struct repair_entry, 1);
+	if(entry==NULL){
+		printf("Can not allocate memory\n");
+		return(NULL);
+	}
+	memset(entry,0,sizeof(struct repair_entry));
+	entry->to_device_ID = to_device_ID;
+	entry->helpers = talloc(int, d);
+	if(entry->helpers==NULL){
+		printf("Can not allocate memory\n");
+		free_repair_entry(entry);
+		return(NULL);
+	}
+	memcpy(entry->helpers,helpers,sizeof(int)*d);
+	if(make_entry(entry, info)<0){
+		free_repair_entry(entry);
+		return(NULL);
+	}
+	entry->refs = 1;
+
+	pthread_mutex_lock(&cache->lock);
+	found = find_repair_entry(to_device_ID, helpers, info);
+	if(found!=NULL){ // another thread got there first
+		found->refs++;
+		found->last_used = ++cache->clock;
+		pthread_mutex_unlock(&cache->lock);
+		free_repair_entry(entry);
+		return(found);
+	}
+	entry->last_used = ++cache->clock;
+	if(cache->num_of_entries<REPAIR_CACHE_SIZE){
+		cache->entries[cache->num_of_entries] = entry;
+		cache->num_of_entries++;
+		entry->cached = 1;
+	}
+	else{ // replace the least recently used entry that nobody is using
+		victim = -1;
+		for(i=0;i<REPAIR_CACHE_SIZE;i++){
+			if(cache->entries[i]->refs==0&&(victim<0||cache->entries[i]->last_used<cache->entries[victim]->last_used))
+				victim = i;
+		}
+		if(victim>=0){
+			free_repair_entry(cache->entries[victim]);
+			cache->entries[victim] = entry;
+			entry->cached = 1;
+		}
+	}
+	pthread_mutex_unlock(&cache->lock);
+	return(entry);
+}
+
+void put_repair_entry(struct repair_entry *entry, struct coding_info *info)
+{
+	int release;
+
+	pthread_mutex_lock(&info->repair_cache->lock);
+	entry->refs--;
+	release = (entry->cached==0&&entry->refs==0);
+	pthread_mutex_unlock(&info->repair_cache->lock);
+	if(release)
+		free_repair_entry(entry);
+}
+
+struct decode_plan* make_decode_plan(int* erasures, struct coding_info *info)
+{
+	int i,counter,ret;
+	int n = info->req.n;
+	int k = info->req.k;
+	struct decode_plan *plan = talloc(struct decode_plan, 1);
+	if(plan==NULL){
+		printf("Can not allocate memory\n");
+		return(NULL);
+	}
+	memset(plan,0,sizeof(struct decode_plan));
+	plan->backend = info->backend;
+	for(i=0;erasures[i]!=-1;i++);
+	plan->erasures = talloc(int, i+1);
+	plan->remaining = talloc(int, k);
+	if(plan->erasures==NULL||plan->remaining==NULL){
+		printf("Can not allocate memory\n");
+		free_decode_plan(plan);
+		return(NULL);
+	}
+	memcpy(plan->erasures,erasures,sizeof(int)*(i+1));
+	plan->erased = jerasure_erasures_to_erased(k, n-k, erasures);
+	if(plan->erased==NULL){
+		printf("Too many erasures, can not recover.\n");
+		free_decode_plan(plan);
+		return(NULL);
+	}
+	for(i=0,counter=0;i<n&&counter<k;i++){
+		if(plan->erased[i]==0){
+			plan->remaining[counter] = i;
+			counter++;
+		}
+	}
+
+	switch (info->req.type)
+	{
+		case MBR_REPAIRBYTRANSFER:
+			ret = make_decode_plan_MBR_repair_by_transfer(plan, info);
+			break;
+		case MSR_PRODUCTMATRIX:
+			ret = make_decode_plan_MSR_product_matrix(plan, info);
+			break;
+		case MBR_PRODUCTMATRIX:
+			ret = make_decode_plan_MBR_product_matrix(plan, info);
+			break;
+		case SRC:
+			ret = make_decode_plan_SRC(plan, info);
+			break;
+		case LRC:
+			ret = make_decode_plan_LRC(plan, info);
+			break;
+		case STEINERCODE:
+		default:
+			printf("This type of regenerating code is not supported. \n");
+			ret = -1;
+	}
+	if(ret<0){
+		free_decode_plan(plan);
+		return(NULL);
+	}
+	return(plan);
+}
+
+void free_decode_plan(struct decode_plan *plan)
+{
+	int i;
+
+	if(plan==NULL)
+		return;
+	for(i=0;i<plan->num_of_schedules;i++){
+		if(plan->erasures_array!=NULL&&plan->erasures_array[i]!=NULL)
+			free(plan->erasures_array[i]);
+		if(plan->erased_array!=NULL&&plan->erased_array[i]!=NULL)
+			free(plan->erased_array[i]);
+		if(plan->schedule_array!=NULL&&plan->schedule_array[i]!=NULL)
+			jerasure_free_flat_schedule(plan->schedule_array[i]);
+		if(plan->matrix_array!=NULL&&plan->matrix_array[i]!=NULL)
+			free(plan->matrix_array[i]);
+		if(plan->src_ids_array!=NULL&&plan->src_ids_array[i]!=NULL)
+			free(plan->src_ids_array[i]);
+	}
+	if(plan->matrix_array!=NULL)
+		free(plan->matrix_array);
+	if(plan->collapsed_matrix!=NULL)
+		free(plan->collapsed_matrix);
+	if(plan->collapsed_schedule!=NULL)
+		jerasure_free_flat_schedule(plan->collapsed_schedule);
+	if(plan->src_ids_array!=NULL)
+		free(plan->src_ids_array);
+	if(plan->erasures_array!=NULL)
+		free(plan->erasures_array);
+	if(plan->erased_array!=NULL)
+		free(plan->erased_array);
+	if(plan->schedule_array!=NULL)
+		free(plan->schedule_array);
+	if(plan->erasures!=NULL)
+		free(plan->erasures);
+	if(plan->erased!=NULL)
+		free(plan->erased);
+	if(plan->remaining!=NULL)
+		free(plan->remaining);
+	free(plan);
+}
+
+int get_requirement(enum codetype type, struct requirement *req, int n, int k, int d, int w)
+{
+	if(n<3||k>=n||k<3)
+	{
+		printf("This type of regenerating code is not supported. \n");
+		return(-1);
+	}
+	// the fields a code does not use are 0, so that requirements can be compared
+	memset(req,0,sizeof(struct requirement));
+	switch (type)
+	{
+		case MBR_REPAIRBYTRANSFER: 
+			if(d>=n||k>=d){
+				printf("This type of regenerating code is not supported. \n");
+				return(-1);
+			}
+			req->inner_n = n*(n-1)/2;
+			if((1<<w)<req->inner_n)
+			{
+				printf("invalid w values.\n");
+				return(-1);
+			}
+			req->type = type;
+			req->inner_k = k*n-k*(k+1)/2;
+			req->multiple_of = req->inner_k*ALIGNMENT*w;	
+			req->min_size = req->multiple_of;
+			req->max_size = MIN((long long)req->multiple_of*1024*1024*8,MAXPACKETSIZE);		
+			req->n = n;
+			req->k = k;
+			req->d = n-1;
+			req->w = w;
+			break;						
+		case MSR_PRODUCTMATRIX:
+			// the decoding needs the first column of \Delta, so d=2k-2 is not supported
+			if(n<=d||d<2*k-1||d<k||(1<<w)<n||k<=2)
+			{
+				printf("invalid n=%d,k=%d,d=%d,w=%d values.\n",n,k,d,w);	
+				return(-1);
+			}
+			req->n = n;
+			req->k = k;
+			req->d = d;				
+			req->type = type;			
+			req->multiple_of = k*(d-k+1)*ALIGNMENT*w;	
+			req->min_size = req->multiple_of;
+			req->max_size = MIN((long long)req->multiple_of*1024*1024*8,MAXPACKETSIZE);		
+			req->w = w;
+			break;
+		case MBR_PRODUCTMATRIX:
+			req->n = n;
+			req->k = k;
+			req->d = d;	
+			if((1<<w)<req->n)
+			{
+				printf("invalid w values.\n");
+				return(-1);
+			}
+			req->type = type;			
+			req->multiple_of = ((k+1)*k/2+k*(d-k))*ALIGNMENT*w;	
+			req->min_size = req->multiple_of;
+			req->max_size = MIN((long long)req->multiple_of*1024*1024*8,MAXPACKETSIZE);		
+			req->w = w;
+			break;
+		case SRC:
+			req->n = n;
+			req->k = k;
+			req->f = d;			
+			if((1<<w)<n||req->f+1>n)
+			{
+				printf("invalid w values.\n");
+				return(-1);
+			}
+			req->type = type;			
+			req->multiple_of = k*req->f*ALIGNMENT*w;	
+			req->min_size = req->multiple_of;
+			req->max_size = MIN((long long)req->multiple_of*1024*1024*8,MAXPACKETSIZE);		
+			req->d = MIN(2*req->f,n-1);
+			req->w = w;
+			break;	
+		case LRC:	
+			req->n = n;
+			req->k = k;
+			req->f = d;			
+			if((1<<w)<n||req->f+1>n)
+			{
+				printf("invalid w values.\n");
+				return(-1);
+			}
+			req->type = type;			
+			req->multiple_of = k*(req->f)*ALIGNMENT*w;	
+			req->min_size = req->multiple_of;
+			req->max_size = MIN((long long)req->multiple_of*1024*1024*8,MAXPACKETSIZE);		
+			req->d = d;
+			req->w = w;
+			break;		
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}
+		
+	return(req->multiple_of);
+}
+
+long long compute_coded_packet_size(struct requirement *req, long long data_size)
+{
+	long long packet_size=-1;		
+	switch (req->type)
+	{
+		case MBR_REPAIRBYTRANSFER: 
+			packet_size = data_size/req->inner_k*(req->n-1);	         
+			break;					
+		case MSR_PRODUCTMATRIX:
+			packet_size = data_size/(req->k);
+			break;
+		case MBR_PRODUCTMATRIX:
+			packet_size = data_size/((req->k+1)*req->k/2+req->k*(req->d-req->k))*req->d;			
+			break;
+		case SRC:
+			packet_size = data_size/(req->k*req->f)*(req->f+1);
+			break;
+		case LRC:
+			packet_size = data_size/(req->k*req->f)*(req->f+1);
+			break;			
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}	
+	return(packet_size);
+}
+
+long long compute_repair_packet_size(struct requirement *req, long long data_size)
+{
+	long long packet_size=-1;		
+	switch (req->type)
+	{
+		case MBR_REPAIRBYTRANSFER: 
+			packet_size = data_size/req->inner_k;	         
+			break;					
+		case MSR_PRODUCTMATRIX:
+			packet_size = data_size/(req->k*(req->d-req->k+1));
+			break;
+		case MBR_PRODUCTMATRIX:
+			packet_size = data_size/((req->k+1)*req->k/2+req->k*(req->d-req->k));
+			break;
+		case SRC:
+			packet_size = data_size/(req->k*(req->f))*(req->f+1);
+			break;
+		case LRC:
+			packet_size = data_size/(req->k*(req->f))*(req->f+1);
+			break;
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}	
+	return(packet_size);
+}
+/*
+int checkValid(size_t inputsize, size_t outputsize, int packetsize, struct Requirement *requirement, int w)
+{
+
+	size_t wordsize = w/8;		
+	if(inputsize/(wordsize*req->multipleof)!=0||inputsize>req->maxSize*wordsize||inputsize<req->maxSize*wordsize)
+	{
+		printf("In correct input packet size. \n");
+		return(-1);
+	}
+	return(1);
+	
+}*/
+
+int encode_rc(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info)
+{
+	if(use_backend(info, NULL)<0)
+		return(-1);
+	switch (info->req.type)
+	{
+		case MBR_REPAIRBYTRANSFER: 			
+			return(encode_MBR_repair_by_transfer(input, input_size, output, output_size, info));
+		case MSR_PRODUCTMATRIX:
+			return(encode_MSR_product_matrix(input, input_size, output, output_size, info));
+		case MBR_PRODUCTMATRIX:
+			return(encode_MBR_product_matrix(input, input_size, output, output_size, info));
+		case SRC:
+			return(encode_SRC(input, input_size, output, output_size, info));
+		case LRC:
+			return(encode_LRC(input, input_size, output, output_size, info));
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}
+}
+int decode_rc(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info)
+{
+	int ret;
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	if(plan==NULL)
+		return(-1);
+	ret = decode_rc_with_plan(input, input_size, output, output_size, plan, info);
+	free_decode_plan(plan);
+	return(ret);	
+}
+int decode_rc_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info)
+{
+	if(use_backend(info, plan)<0)
+		return(-1);
+	switch (info->req.type)
+	{
+		case MBR_REPAIRBYTRANSFER: 			
+			return(decode_MBR_repair_by_transfer_with_plan(input, input_size, output, output_size, plan, info));
+		case MSR_PRODUCTMATRIX:
+			return(decode_MSR_product_matrix_with_plan(input, input_size, output, output_size, plan, info));
+		case MBR_PRODUCTMATRIX:
+			return(decode_MBR_product_matrix_with_plan(input, input_size, output, output_size, plan, info));
+		case SRC:
+			return(decode_SRC_with_plan(input, input_size, output, output_size, plan, info));
+		case LRC:
+			return(decode_LRC_with_plan(input, input_size, output, output_size, plan, info));
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}
+}
+// none of the decoders writes to the surviving devices, so they are used as they are and only the erased 
+// devices are given scratch buffers from the workspace. The phased MSR decoder rebuilds an erased systematic device
+// in the subpackets it holds, which are also its place in output, so it decodes straight into output, and an erased
+// parity device a tile at a time in its own scratch, see decode_MSR_product_matrix_no_output().
+int decode_rc_read_only(const char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info)
+{
+	int ret;
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	if(plan==NULL)
+		return(-1);
+	ret = decode_rc_with_plan_read_only(input, input_size, output, output_size, plan, info);
+	free_decode_plan(plan);
+	return(ret);	
+}
+int decode_rc_with_plan_read_only(const char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info)
+{
+	int i, ret;
+	int n = info->req.n;
+	int k = info->req.k;
+	int alpha = info->req.d-k+1;
+	int phased_msr = info->req.type==MSR_PRODUCTMATRIX&&plan->collapsed_cols==0;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **devices;
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	devices = workspace_alloc(ws, sizeof(char*)*n);
+	if(devices==NULL){
+		printf("Out of memory.\n");
+		workspace_release(ws, mark);
+		return(-1);
+	}
+	for(i=0;i<n;i++){
+		// a collapsed plan writes the erased data straight to the output and never uses the erased devices
+		if(plan->erased[i]==0||plan->collapsed_cols>0){
+			devices[i] = (char*)input[i];
+			continue;
+		}
+		if(phased_msr){
+			devices[i] = i<k?output+(size_t)i*(input_size/alpha)*alpha:NULL;
+			continue;
+		}
+		devices[i] = workspace_alloc(ws, input_size);
+		if(devices[i]==NULL){
+			printf("Out of memory.\n");
+			workspace_release(ws, mark);
+			return(-1);
+		}
+	}
+	ret = decode_rc_with_plan(devices, input_size, output, output_size, plan, info);
+	workspace_release(ws, mark);
+	return(ret);
+}
+int repair_encode_rc(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info)
+{
+	if(use_backend(info, NULL)<0)
+		return(-1);
+	switch (info->req.type)
+	{
+		case MBR_REPAIRBYTRANSFER: 			
+			repair_encode_MBR_repair_by_transfer(input, input_size, output, output_size, from_device_ID, to_device_ID, info);
+			break;						
+		case MSR_PRODUCTMATRIX:
+			repair_encode_MSR_product_matrix(input, input_size, output, output_size, from_device_ID, to_device_ID, info);
+			break;						
+		case MBR_PRODUCTMATRIX:
+			repair_encode_MBR_product_matrix(input, input_size, output, output_size, from_device_ID, to_device_ID, info);
+			break;								
+		case SRC:
+			repair_encode_SRC(input, input_size, output, output_size, from_device_ID, to_device_ID, info);
+			break;
+		case LRC:
+			repair_encode_LRC(input, input_size, output, output_size, from_device_ID, to_device_ID, info);
+			break;
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}
+	return(1);	
+}
+int repair_decode_rc(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info)
+{
+	if(use_backend(info, NULL)<0)
+		return(-1);
+	switch (info->req.type)
+	{
+		case MBR_REPAIRBYTRANSFER: 			
+			repair_decode_MBR_repair_by_transfer(input, input_size, output, output_size, to_device_ID, helpers, info);
+			break;						
+		case MSR_PRODUCTMATRIX:
+			repair_decode_MSR_product_matrix(input, input_size, output, output_size, to_device_ID, helpers, info);
 			break;						
+		case MBR_PRODUCTMATRIX:
+			repair_decode_MBR_product_matrix(input, input_size, output, output_size, to_device_ID, helpers, info);
+			break;								
+		case SRC:
+			repair_decode_SRC(input, input_size, output, output_size, to_device_ID, helpers, info);
+			break;
+		case LRC:
+			repair_decode_LRC(input, input_size, output, output_size, to_device_ID, helpers, info);
+			break;
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}
+	return(1);	
+}
+
+
+
+// the coding functions restricted to bytes [0,length) of every subpacket, the buffers being laid out in subpackets of subpacket_size
+int encode_rc_region(char *input, char **output, int subpacket_size, int length, struct coding_info *info)
+{
+	int ret = -1;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data;
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	data = get_subpacket_ptrs(ws, input, get_num_of_data_subpackets(&info->req), subpacket_size);
+	if(data!=NULL)
+		ret = encode_rc_iov_region(data, output, subpacket_size, length, info);
+	workspace_release(ws, mark);
+	return(ret);
+}
+int decode_rc_region(char **input, char *output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info)
+{
+	int ret = -1;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+	char **data;
+	if(ws==NULL)
+		return(-1);
+	mark = workspace_mark(ws);
+	data = get_subpacket_ptrs(ws, output, get_num_of_data_subpackets(&info->req), subpacket_size);
+	if(data!=NULL)
+		ret = decode_rc_iov_region(input, data, subpacket_size, length, plan, info);
+	workspace_release(ws, mark);
+	return(ret);
+}
+int encode_rc_iov_region(char **data, char **output, int subpacket_size, int length, struct coding_info *info)
+{
+	if(use_backend(info, NULL)<0)
+		return(-1);
+	switch (info->req.type)
+	{
+		case MBR_REPAIRBYTRANSFER:
+			return(encode_MBR_repair_by_transfer_iov(data, output, subpacket_size, length, info));
+		case MSR_PRODUCTMATRIX:
+			return(encode_MSR_product_matrix_iov(data, output, subpacket_size, length, info));
+		case MBR_PRODUCTMATRIX:
+			return(encode_MBR_product_matrix_iov(data, output, subpacket_size, length, info));
+		case SRC:
+			return(encode_SRC_iov(data, output, subpacket_size, length, info));
+		case LRC:
+			return(encode_LRC_iov(data, output, subpacket_size, length, info));
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}
+}
+int decode_rc_iov_region(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info)
+{
+	if(use_backend(info, plan)<0)
+		return(-1);
+	switch (info->req.type)
+	{
+		case MBR_REPAIRBYTRANSFER:
+			return(decode_MBR_repair_by_transfer_iov(input, output, subpacket_size, length, plan, info));
+		case MSR_PRODUCTMATRIX:
+			return(decode_MSR_product_matrix_iov(input, output, subpacket_size, length, plan, info));
+		case MBR_PRODUCTMATRIX:
+			return(decode_MBR_product_matrix_iov(input, output, subpacket_size, length, plan, info));
+		case SRC:
+			return(decode_SRC_iov(input, output, subpacket_size, length, plan, info));
+		case LRC:
+			return(decode_LRC_iov(input, output, subpacket_size, length, plan, info));
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}
+}
+int repair_encode_rc_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info)
+{
+	if(use_backend(info, NULL)<0)
+		return(-1);
+	switch (info->req.type)
+	{
+		case MBR_REPAIRBYTRANSFER:
+			return(repair_encode_MBR_repair_by_transfer_region(input, output, subpacket_size, length, from_device_ID, to_device_ID, info));
+		case MSR_PRODUCTMATRIX:
+			return(repair_encode_MSR_product_matrix_region(input, output, subpacket_size, length, from_device_ID, to_device_ID, info));
+		case MBR_PRODUCTMATRIX:
+			return(repair_encode_MBR_product_matrix_region(input, output, subpacket_size, length, from_device_ID, to_device_ID, info));
+		case SRC:
+			return(repair_encode_SRC_region(input, output, subpacket_size, length, from_device_ID, to_device_ID, info));
+		case LRC:
+			return(repair_encode_LRC_region(input, output, subpacket_size, length, from_device_ID, to_device_ID, info));
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}
+}
+int repair_decode_rc_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info)
+{
+	if(use_backend(info, NULL)<0)
+		return(-1);
+	switch (info->req.type)
+	{
+		case MBR_REPAIRBYTRANSFER:
+			return(repair_decode_MBR_repair_by_transfer_region(input, output, subpacket_size, length, to_device_ID, helpers, info));
+		case MSR_PRODUCTMATRIX:
+			return(repair_decode_MSR_product_matrix_region(input, output, subpacket_size, length, to_device_ID, helpers, info));
+		case MBR_PRODUCTMATRIX:
+			return(repair_decode_MBR_product_matrix_region(input, output, subpacket_size, length, to_device_ID, helpers, info));
+		case SRC:
+			return(repair_decode_SRC_region(input, output, subpacket_size, length, to_device_ID, helpers, info));
+		case LRC:
+			return(repair_decode_LRC_region(input, output, subpacket_size, length, to_device_ID, helpers, info));
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}
+}
+
+/* Parallel coding. Every byte of a packet only depends on the bytes at the same position of the other packets,
+so the subpackets are cut into slabs of whole ALIGNMENT*w packets and each slab is coded with the *_region()
+functions on a thread of the pool. The slabs write disjoint bytes and the result is the same as that of the 
+serial functions. Each thread uses its own workspace, and decoding shares one plan between the slabs. */
+
+enum slab_operation{
+	SLAB_ENCODE,
+	SLAB_DECODE,
+	SLAB_REPAIR_ENCODE,
+	SLAB_REPAIR_DECODE
+};
+
+struct slab_job
+{
+	enum slab_operation operation;
+	char* input;
+	char** input_array;
+	int num_of_inputs;	// entries of input_array
+	char* output;
+	char** output_array;
+	int num_of_outputs;	// entries of output_array
+	int subpacket_size;
+	int slab_size;		// bytes of each subpacket in one slab
+	int from_device_ID;
+	int to_device_ID;
+	int* helpers;
+	struct decode_plan* plan;
+	struct coding_info* info;
+	int failed;
+};
+
+// number of subpackets stored on each device
+int get_subpackets_per_device(struct requirement *req)
+{
+	switch (req->type)
+	{
+		case MBR_REPAIRBYTRANSFER: 
+			return(req->n-1);
+		case MSR_PRODUCTMATRIX:
+			return(req->d-req->k+1);
+		case MBR_PRODUCTMATRIX:
+			return(req->d);
+		case SRC:
+		case LRC:
+			return(req->f+1);
+		case STEINERCODE:
+		default: 
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);			
+	}
+}
+
+// copy of the pointer array with every pointer moved offset bytes ahead
+static char** shift_ptrs(struct workspace *ws, char **ptrs, int num, int offset)
+{
+	int i;
+	char **shifted = workspace_alloc(ws, sizeof(char*)*num);
+	if(shifted==NULL)
+		return(NULL);
+	for(i=0;i<num;i++)
+		shifted[i] = ptrs[i]+offset;
+	return(shifted);
+}
+
+static void run_slab(void *arg, int index)
+{
+	struct slab_job *job = arg;
+	struct coding_info *info = job->info;
+	int offset = index*job->slab_size;
+	int length = MIN(job->slab_size, job->subpacket_size-offset);
+	int ret = -1;
+	char **input_array = NULL, **output_array = NULL;
+	struct workspace *ws = get_workspace(info);
+	size_t mark;
+
+	if(ws==NULL){
+		__atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	mark = workspace_mark(ws);
+	if(job->input_array!=NULL)
+		input_array = shift_ptrs(ws, job->input_array, job->num_of_inputs, offset);
+	if(job->output_array!=NULL)
+		output_array = shift_ptrs(ws, job->output_array, job->num_of_outputs, offset);
+	if((job->input_array!=NULL&&input_array==NULL)||(job->output_array!=NULL&&output_array==NULL)){
+		printf("Out of memory.\n");
+		workspace_release(ws, mark);
+		__atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+		return;
+	}
+	switch (job->operation)
+	{
+		case SLAB_ENCODE:
+			ret = encode_rc_region(job->input+offset, output_array, job->subpacket_size, length, info);
+			break;
+		case SLAB_DECODE:
+			ret = decode_rc_region(input_array, job->output+offset, job->subpacket_size, length, job->plan, info);
+			break;
+		case SLAB_REPAIR_ENCODE:
+			ret = repair_encode_rc_region(job->input+offset, job->output+offset, job->subpacket_size, length, 
+					job->from_device_ID, job->to_device_ID, info);
+			break;
+		case SLAB_REPAIR_DECODE:
+			ret = repair_decode_rc_region(input_array, job->output+offset, job->subpacket_size, length, 
+					job->to_device_ID, job->helpers, info);
+			break;
+	}
+	workspace_release(ws, mark);
+	if(ret<0)
+		__atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+}
+
+// cuts the subpackets of the device packets of device_size bytes into slabs and runs them on the pool
+static int run_slab_job(struct slab_job *job, size_t device_size, struct thread_pool *pool)
+{
+	struct coding_info *info = job->info;
+	int packet_size = ALIGNMENT*info->req.w;
+	int subpackets = get_subpackets_per_device(&info->req);
+	int num_of_packets, num_of_slabs, num_of_threads;
+
+	if(subpackets<0)
+		return(-1);
+	job->subpacket_size = device_size/subpackets;
+	job->failed = 0;
+	num_of_threads = (pool==NULL)?1:pool->num_of_threads+1;
+	// a subpacket that is not made of whole packets can only be coded as one slab
+	if(job->subpacket_size%packet_size!=0||job->subpacket_size<packet_size)
+		job->slab_size = job->subpacket_size;
+	else{
+		num_of_packets = job->subpacket_size/packet_size;
+		num_of_slabs = MIN(num_of_packets, num_of_threads);
+		job->slab_size = (num_of_packets+num_of_slabs-1)/num_of_slabs*packet_size;
+	}
+	if(job->slab_size==0)
+		return(-1);
+	num_of_slabs = (job->subpacket_size+job->slab_size-1)/job->slab_size;
+	thread_pool_run(pool, num_of_slabs, run_slab, job);
+	return(job->failed?-1:1);
+}
+
+int encode_rc_parallel(char *input, size_t input_size, char **output, size_t output_size, struct thread_pool *pool, struct coding_info *info)
+{
+	struct slab_job job;
+	memset(&job, 0, sizeof(job));
+	job.operation = SLAB_ENCODE;
+	job.input = input;
+	job.output_array = output;
+	job.num_of_outputs = info->req.n;
+	job.info = info;
+	return(run_slab_job(&job, output_size, pool));
+}
+
+int decode_rc_parallel(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct thread_pool *pool, struct coding_info *info)
+{
+	int ret;
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	if(plan==NULL)
+		return(-1);
+	ret = decode_rc_with_plan_parallel(input, input_size, output, output_size, plan, pool, info);
+	free_decode_plan(plan);
+	return(ret);
+}
+
+int decode_rc_with_plan_parallel(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct thread_pool *pool, struct coding_info *info)
+{
+	struct slab_job job;
+	memset(&job, 0, sizeof(job));
+	job.operation = SLAB_DECODE;
+	job.input_array = input;
+	job.num_of_inputs = info->req.n;
+	job.output = output;
+	job.plan = plan;
+	job.info = info;
+	return(run_slab_job(&job, input_size, pool));
+}
+
+int repair_encode_rc_parallel(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct thread_pool *pool, struct coding_info *info)
+{
+	struct slab_job job;
+	memset(&job, 0, sizeof(job));
+	job.operation = SLAB_REPAIR_ENCODE;
+	job.input = input;
+	job.output = output;
+	job.from_device_ID = from_device_ID;
+	job.to_device_ID = to_device_ID;
+	job.info = info;
+	return(run_slab_job(&job, input_size, pool));
+}
+
+int repair_decode_rc_parallel(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct thread_pool *pool, struct coding_info *info)
+{
+	int i;
+	struct slab_job job;
+	memset(&job, 0, sizeof(job));
+	job.operation = SLAB_REPAIR_DECODE;
+	job.input_array = input;
+	// one repair packet per helper, helpers is terminated by -1 unless all n-1 other devices help
+	for(i=0;i<info->req.n-1&&helpers[i]>=0;i++);
+	job.num_of_inputs = i;
+	job.output = output;
+	job.to_device_ID = to_device_ID;
+	job.helpers = helpers;
+	job.info = info;
+	return(run_slab_job(&job, output_size, pool));
+}
+
+// number of subpackets the data of a stripe is cut into
+int get_num_of_data_subpackets(struct requirement *req)
+{
+	switch (req->type)
+	{
+		case MBR_REPAIRBYTRANSFER: 
+			return(req->inner_k);
 		case MSR_PRODUCTMATRIX:
-			repair_encode_MSR_product_matrix(input, input_size, output, output_size, from_device_ID, to_device_ID, info);
-			break;						
+			return(req->k*(req->d-req->k+1));
 		case MBR_PRODUCTMATRIX:
-			repair_encode_MBR_product_matrix(input, input_size, output, output_size, from_device_ID, to_device_ID, info);
-			break;								
+			return((req->k+1)*req->k/2+req->k*(req->d-req->k));
 		case SRC:
-			repair_encode_SRC(input, input_size, output, output_size, from_device_ID, to_device_ID, info);
-			break;
 		case LRC:
-			repair_encode_LRC(input, input_size, output, output_size, from_device_ID, to_device_ID, info);
-			break;
+			return(req->k*req->f);
 		case STEINERCODE:
 		default: 
 			printf("This type of regenerating code is not supported. \n");
 			return(-1);			
 	}
-	return(1);	
 }
-int repair_decode_rc(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info)
+
+// data subpacket j is stored as subpacket position[j] of device device_ID[j]. The MBR codes store each data 
+// subpacket on two devices, the one given is the device with the lower ID. Returns the number of data subpackets.
+int get_data_layout(struct requirement *req, int *device_ID, int *position)
 {
-	switch (info->req.type)
+	int i,j,counter;
+	int num_of_data = get_num_of_data_subpackets(req);
+	switch (req->type)
 	{
-		case MBR_REPAIRBYTRANSFER: 			
-			repair_decode_MBR_repair_by_transfer(input, input_size, output, output_size, to_device_ID, helpers, info);
-			break;						
-		case MSR_PRODUCTMATRIX:
-			repair_decode_MSR_product_matrix(input, input_size, output, output_size, to_device_ID, helpers, info);
-			break;						
+		case MBR_REPAIRBYTRANSFER: 
+			// device i holds the subpackets i..n-2 of the inner code in its rows i..n-2
+			for(counter=0,i=0;i<req->n&&counter<num_of_data;i++){
+				for(j=i;j<req->n-1&&counter<num_of_data;j++,counter++){
+					device_ID[counter] = i;
+					position[counter] = j;
+				}
+			}
+			break;
 		case MBR_PRODUCTMATRIX:
-			repair_decode_MBR_product_matrix(input, input_size, output, output_size, to_device_ID, helpers, info);
-			break;								
-		case SRC:
-			repair_decode_SRC(input, input_size, output, output_size, to_device_ID, helpers, info);
+			// row i of the upper triangle of the message matrix, from column i on, is on device i
+			for(counter=0,i=0;i<req->k;i++){
+				for(j=i;j<req->d;j++,counter++){
+					device_ID[counter] = i;
+					position[counter] = j;
+				}
+			}
 			break;
+		case MSR_PRODUCTMATRIX:
+		case SRC:
 		case LRC:
-			repair_decode_LRC(input, input_size, output, output_size, to_device_ID, helpers, info);
+			// the data is stored in order on the first devices
+			for(counter=0;counter<num_of_data;counter++){
+				device_ID[counter] = counter/(num_of_data/req->k);
+				position[counter] = counter%(num_of_data/req->k);
+			}
 			break;
 		case STEINERCODE:
 		default: 
 			printf("This type of regenerating code is not supported. \n");
 			return(-1);			
 	}
-	return(1);	
+	return(num_of_data);
+}
+
+char** get_subpacket_ptrs(struct workspace *ws, char *buffer, int num, int subpacket_size)
+{
+	int i;
+	char **ptrs;
+	if(num<0)
+		return(NULL);
+	ptrs = workspace_alloc(ws, sizeof(char*)*num);
+	if(ptrs==NULL){
+		printf("Out of memory.\n");
+		return(NULL);
+	}
+	for(i=0;i<num;i++)
+		ptrs[i] = buffer+(size_t)i*subpacket_size;
+	return(ptrs);
+}
+
+// copies length bytes unless src already is dest, large regions with non-temporal stores (see copy_bytes())
+void copy_region(char *dest, char *src, int length)
+{
+	if(dest!=src)
+		copy_bytes(dest, src, length);
+}
+
+// points *dest to src if *dest is NULL, copies the bytes otherwise
+void place_region(char **dest, char *src, int length)
+{
+	if(*dest==NULL)
+		*dest = src;
+	else
+		copy_region(*dest, src, length);
+}
+
+int encode_rc_iov(char **data, char **output, size_t output_size, struct coding_info *info)
+{
+	int subpackets = get_subpackets_per_device(&info->req);
+	if(subpackets<0)
+		return(-1);
+	return(encode_rc_iov_region(data, output, output_size/subpackets, output_size/subpackets, info));
+}
+
+int decode_rc_iov(char **input, size_t input_size, char **output, int* erasures, struct coding_info *info)
+{
+	int ret;
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	if(plan==NULL)
+		return(-1);
+	ret = decode_rc_iov_with_plan(input, input_size, output, plan, info);
+	free_decode_plan(plan);
+	return(ret);
+}
+
+int decode_rc_iov_with_plan(char **input, size_t input_size, char **output, struct decode_plan *plan, struct coding_info *info)
+{
+	int subpackets = get_subpackets_per_device(&info->req);
+	if(subpackets<0)
+		return(-1);
+	return(decode_rc_iov_region(input, output, input_size/subpackets, input_size/subpackets, plan, info));
+}
+
+/* Batches of stripes of the same code. The stripes are split into runs of consecutive stripes, one run per
+thread of the pool, and every stripe is coded with encode_rc() or decode_rc_with_plan(). Decoding makes one 
+plan for the whole batch; apart from that, each stripe does the same setup as a call of its own (pointer arrays,
+workspace lookup and the choice of schedules), which is small next to the coding of a stripe. */
+
+struct stripe_job
+{
+	enum slab_operation operation;	// SLAB_ENCODE or SLAB_DECODE, on whole stripes
+	char** input;
+	char*** input_array;
+	size_t input_size;
+	char** output;
+	char*** output_array;
+	size_t output_size;
+	int num_of_stripes;
+	int stripes_per_task;
+	struct decode_plan* plan;
+	struct coding_info* info;
+	int failed;
+};
+
+static void run_stripes(void *arg, int index)
+{
+	struct stripe_job *job = arg;
+	int i = index*job->stripes_per_task;
+	int end = MIN(i+job->stripes_per_task, job->num_of_stripes);
+	int ret = 1;
+
+	for(;i<end&&ret>0;i++){
+		if(job->operation==SLAB_ENCODE)
+			ret = encode_rc(job->input[i], job->input_size, job->output_array[i], job->output_size, job->info);
+		else
+			ret = decode_rc_with_plan(job->input_array[i], job->input_size, job->output[i], job->output_size, job->plan, job->info);
+	}
+	if(ret<0)
+		__atomic_store_n(&job->failed, 1, __ATOMIC_RELAXED);
+}
+
+static int run_stripe_job(struct stripe_job *job, struct thread_pool *pool)
+{
+	int num_of_tasks = (pool==NULL)?1:pool->num_of_threads+1;
+	if(job->num_of_stripes<=0)
+		return(1);
+	num_of_tasks = MIN(num_of_tasks, job->num_of_stripes);
+	job->stripes_per_task = (job->num_of_stripes+num_of_tasks-1)/num_of_tasks;
+	num_of_tasks = (job->num_of_stripes+job->stripes_per_task-1)/job->stripes_per_task;
+	job->failed = 0;
+	thread_pool_run(pool, num_of_tasks, run_stripes, job);
+	return(job->failed?-1:1);
+}
+
+int encode_rc_batch(char **input, size_t input_size, char ***output, size_t output_size, int num_of_stripes, struct thread_pool *pool, struct coding_info *info)
+{
+	struct stripe_job job;
+	memset(&job, 0, sizeof(job));
+	job.operation = SLAB_ENCODE;
+	job.input = input;
+	job.input_size = input_size;
+	job.output_array = output;
+	job.output_size = output_size;
+	job.num_of_stripes = num_of_stripes;
+	job.info = info;
+	return(run_stripe_job(&job, pool));
+}
+
+int decode_rc_batch(char ***input, size_t input_size, char **output, size_t output_size, int num_of_stripes, int* erasures, struct thread_pool *pool, struct coding_info *info)
+{
+	int ret;
+	struct stripe_job job;
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	if(plan==NULL)
+		return(-1);
+	memset(&job, 0, sizeof(job));
+	job.operation = SLAB_DECODE;
+	job.input_array = input;
+	job.input_size = input_size;
+	job.output = output;
+	job.output_size = output_size;
+	job.num_of_stripes = num_of_stripes;
+	job.plan = plan;
+	job.info = info;
+	ret = run_stripe_job(&job, pool);
+	free_decode_plan(plan);
+	return(ret);
+}
+
+/* Streaming. An object of any size is coded as a sequence of stripes of stripe_size data bytes, the last one 
+holding the rest of the object padded with zeros to a multiple of req.multiple_of. Device i stores the 
+concatenation of its packets of all the stripes. Only one stripe of data and its n packets are held in memory,
+and each is handed to the write callback as soon as it is complete. */
+
+static int init_stream(struct rc_stream *stream, int decoding, long long object_size, int stripe_size, int* erasures, 
+		rc_stream_write write, void *arg, struct coding_info *info)
+{
+	int i;
+	int n = info->req.n;
+	long long packet_size;
+
+	memset(stream, 0, sizeof(struct rc_stream));
+	// by default the largest stripe of at most STREAM_STRIPE_SIZE bytes, so that a stream holds a few MB whatever
+	// the size of the object
+	if(stripe_size<=0)
+		stripe_size = MAX(MIN(STREAM_STRIPE_SIZE, info->req.max_size)/info->req.multiple_of, 1)*info->req.multiple_of;
+	if(stripe_size<info->req.multiple_of||stripe_size%info->req.multiple_of!=0||stripe_size>info->req.max_size){
+		printf("Incorrect stripe size.\n");
+		return(-1);
+	}
+	packet_size = compute_coded_packet_size(&info->req, stripe_size);
+	if(packet_size<0)
+		return(-1);
+	stream->info = info;
+	stream->decoding = decoding;
+	stream->object_size = object_size;
+	stream->stripe_size = stripe_size;
+	stream->packet_size = packet_size;
+	stream->write = write;
+	stream->arg = arg;
+	stream->data = malloc(stripe_size);
+	stream->coded = calloc(n, sizeof(char*));
+	if(stream->data==NULL||stream->coded==NULL){
+		printf("Out of memory.\n");
+		cleanup_stream(stream);
+		return(-1);
+	}
+	for(i=0;i<n;i++){
+		stream->coded[i] = malloc(packet_size);
+		if(stream->coded[i]==NULL){
+			printf("Out of memory.\n");
+			cleanup_stream(stream);
+			return(-1);
+		}
+	}
+	if(decoding){
+		stream->plan = make_decode_plan(erasures, info);
+		if(stream->plan==NULL){
+			cleanup_stream(stream);
+			return(-1);
+		}
+	}
+	return(1);
+}
+
+int init_encode_stream(struct rc_stream *stream, int stripe_size, rc_stream_write write, void *arg, struct coding_info *info)
+{
+	return(init_stream(stream, 0, 0, stripe_size, NULL, write, arg, info));
+}
+
+int init_decode_stream(struct rc_stream *stream, long long object_size, int stripe_size, int* erasures, rc_stream_write write, void *arg, struct coding_info *info)
+{
+	if(object_size<0){
+		printf("Incorrect object size.\n");
+		return(-1);
+	}
+	return(init_stream(stream, 1, object_size, stripe_size, erasures, write, arg, info));
+}
+
+// data bytes of the current stripe once padded, i.e., the smallest multiple of req.multiple_of holding them
+static int get_padded_size(struct rc_stream *stream, long long size)
+{
+	int multiple_of = stream->info->req.multiple_of;
+	return((int)((size+multiple_of-1)/multiple_of*multiple_of));
+}
+
+// encodes the first fill bytes of the stripe buffer and writes out the packets
+static int encode_stripe(struct rc_stream *stream)
+{
+	int i;
+	struct coding_info *info = stream->info;
+	int padded_size = get_padded_size(stream, stream->fill);
+	long long packet_size = compute_coded_packet_size(&info->req, padded_size);
+
+	memset(stream->data+stream->fill, 0, padded_size-stream->fill);
+	if(encode_rc(stream->data, padded_size, stream->coded, packet_size, info)<0)
+		return(-1);
+	for(i=0;i<info->req.n;i++){
+		if(stream->write(stream->arg, i, stream->coded[i], packet_size)<0)
+			return(-1);
+	}
+	stream->done += stream->fill;
+	stream->fill = 0;
+	return(1);
+}
+
+int feed_encode_stream(struct rc_stream *stream, char *input, size_t size)
+{
+	size_t count;
+	if(stream->decoding){
+		printf("Not an encoding stream.\n");
+		return(-1);
+	}
+	while(size>0){
+		count = MIN(size, (size_t)(stream->stripe_size-stream->fill));
+		memcpy(stream->data+stream->fill, input, count);
+		stream->fill += count;
+		stream->object_size += count;
+		input += count;
+		size -= count;
+		if(stream->fill==stream->stripe_size&&encode_stripe(stream)<0)
+			return(-1);
+	}
+	return(1);
+}
+
+// packet bytes per device of the current stripe
+static long long get_stripe_packet_size(struct rc_stream *stream)
+{
+	long long left = stream->object_size-stream->done;
+	if(left>=stream->stripe_size)
+		return(stream->packet_size);
+	return(compute_coded_packet_size(&stream->info->req, get_padded_size(stream, left)));
+}
+
+int feed_decode_stream(struct rc_stream *stream, char **input, size_t size)
+{
+	int i;
+	struct coding_info *info = stream->info;
+	long long packet_size, left;
+	size_t count, offset = 0;
+	if(!stream->decoding){
+		printf("Not a decoding stream.\n");
+		return(-1);
+	}
+	while(size>0){
+		left = stream->object_size-stream->done;
+		if(left<=0){
+			printf("More input than the object holds.\n");
+			return(-1);
+		}
+		packet_size = get_stripe_packet_size(stream);
+		count = MIN(size, (size_t)(packet_size-stream->fill));
+		for(i=0;i<info->req.n;i++){
+			if(stream->plan->erased[i]==0)
+				memcpy(stream->coded[i]+stream->fill, input[i]+offset, count);
+		}
+		stream->fill += count;
+		offset += count;
+		size -= count;
+		if(stream->fill<packet_size)
+			continue;
+		// a whole stripe is in, decode and write out the data without the padding
+		if(decode_rc_with_plan(stream->coded, packet_size, stream->data, get_padded_size(stream, MIN(left, stream->stripe_size)), 
+					stream->plan, info)<0)
+			return(-1);
+		if(stream->write(stream->arg, -1, stream->data, MIN(left, stream->stripe_size))<0)
+			return(-1);
+		stream->done += MIN(left, stream->stripe_size);
+		stream->fill = 0;
+	}
+	return(1);
+}
+
+int finish_stream(struct rc_stream *stream)
+{
+	if(stream->decoding){
+		if(stream->done<stream->object_size){
+			printf("Incomplete coded input.\n");
+			return(-1);
+		}
+		return(1);
+	}
+	if(stream->fill>0)
+		return(encode_stripe(stream));
+	return(1);
+}
+
+void cleanup_stream(struct rc_stream *stream)
+{
+	int i;
+	if(stream->coded!=NULL){
+		for(i=0;i<stream->info->req.n;i++)
+			free(stream->coded[i]);
+		free(stream->coded);
+	}
+	free(stream->data);
+	if(stream->plan!=NULL)
+		free_decode_plan(stream->plan);
+	memset(stream, 0, sizeof(struct rc_stream));
+}
+
+/* Serialized coding_info. The file has a header followed by the matrices, bitmatrices and schedules as
+flat int arrays at 64-byte aligned offsets. It holds no pointers, so any number of processes can map the 
+same file read-only and share its pages. Bitmatrices are packed, and schedules are stored as the data block 
+of their flat form (see jerasure_add.h), so that only the struct pointing into it is rebuilt on loading. */
+
+#define CODING_INFO_MAGIC "RGCINFO"
+#define CODING_INFO_VERSION 8	// 1 stored the schedules as rows of 5 ints, 2 the bitmatrices with an int per bit,
+				// 3 the schedules without temporaries, 4 the requirement without low_density, 5 MSR
+				// without the systematic generator, 6 the fields of the requirement a code does not use
+				// as they were left by the caller, 7 no backend
+#define CODING_INFO_BYTE_ORDER 0x01020304
+#define NUM_OF_SECTIONS 18	// matrix, bitmatrix and schedule of the coding matrix and of up to 5 submatrices
+
+struct coding_info_section
+{
+	long long offset;	// in bytes from the start of the file, 0 if the array is NULL
+	long long count;	// number of ints
+};
+
+struct coding_info_file_header
+{
+	char magic[8];
+	int version;
+	int byte_order;
+	int int_size;
+	int num_of_submatrices;
+	int backend;		// the coded data of a code made from this file is that of this backend
+	struct requirement req;
+	long long file_size;
+	struct coding_info_section sections[NUM_OF_SECTIONS];
+};
+
+// columns and rows of the coding matrix (index 0) and of submatrix index-1, as built by make_coding_matrics()
+static int get_matrix_size(struct coding_info *info, int index, int *cols, int *rows)
+{
+	int n = info->req.n;
+	int k = info->req.k;
+	int d = info->req.d;
+	int mbr_pm_cols[3] = {d, k, d-k};
+	int msr_pm_cols[6] = {d, k, d-k+1, d-2*k+2, k-1, k*(d-k+1)};
+
+	switch (info->req.type)
+	{
+		case MBR_PRODUCTMATRIX:
+			*cols = mbr_pm_cols[index];
+			*rows = n-k;
+			break;
+		case MSR_PRODUCTMATRIX:
+			*cols = msr_pm_cols[index];
+			*rows = index==5?(n-k)*(d-k+1):n;
+			break;
+		case MBR_REPAIRBYTRANSFER:
+			*cols = info->req.inner_k;
+			*rows = info->req.inner_n-info->req.inner_k;
+			break;
+		case SRC:
+		case LRC:
+			*cols = k;
+			*rows = n-k;
+			break;
+		default:
+			return(-1);
+	}
+	return(1);
+}
+
+
+static long long add_section(struct coding_info_section *section, long long offset, long long count)
+{
+	section->count = count;
+	section->offset = count>0?offset:0;
+	if(count==0)
+		return(offset);
+	return((offset+count*sizeof(int)+WORKSPACE_ALIGNMENT-1)/WORKSPACE_ALIGNMENT*WORKSPACE_ALIGNMENT);
+}
+
+static int write_section(FILE *fp, struct coding_info_section *section, int *array)
+{
+	if(section->count==0)
+		return(1);
+	if(fseek(fp,section->offset,SEEK_SET)!=0)
+		return(-1);
+	return(fwrite(array,sizeof(int),section->count,fp)==section->count?1:-1);
+}
+
+// writes the matrices of a coding_info made by make_coding_matrics() to path, and its backend, which is then the backend
+// of every code loaded from the file
+int save_coding_info(const char *path, struct coding_info *info)
+{
+	int i, cols, rows, ret = 1;
+	int w = info->req.w;
+	int *matrices[NUM_OF_SECTIONS/3];
+	unsigned int *bitmatrices[NUM_OF_SECTIONS/3];
+	struct jerasure_flat_schedule *schedules[NUM_OF_SECTIONS/3];
+	long long offset;
+	struct coding_info_file_header header;
+	FILE *fp;
+
+	// a saved file always has every table, so that nothing is built after loading it
+	if(get_bitmatrix(info)==NULL||get_schedule(info)==NULL)
+		return(-1);
+	for(i=0;i<info->num_of_submatrices;i++){
+		if(get_subbitmatrix(info,i)==NULL||get_subschedule(info,i)==NULL)
+			return(-1);
+	}
+	matrices[0] = info->matrix;
+	bitmatrices[0] = info->bitmatrix;
+	schedules[0] = info->schedule;
+	for(i=0;i<info->num_of_submatrices;i++){
+		matrices[i+1] = info->submatrix_array[i];
+		bitmatrices[i+1] = info->subbitmatrix_array[i];
+		schedules[i+1] = info->subschedule_array[i];
+	}
+
+	memset(&header,0,sizeof(header));
+	memcpy(header.magic,CODING_INFO_MAGIC,sizeof(CODING_INFO_MAGIC));
+	header.version = CODING_INFO_VERSION;
+	header.byte_order = CODING_INFO_BYTE_ORDER;
+	header.int_size = sizeof(int);
+	header.num_of_submatrices = info->num_of_submatrices;
+	header.backend = info->backend;
+	header.req = info->req;
+	offset = (sizeof(header)+WORKSPACE_ALIGNMENT-1)/WORKSPACE_ALIGNMENT*WORKSPACE_ALIGNMENT;
+	for(i=0;i<=info->num_of_submatrices;i++){
+		if(get_matrix_size(info,i,&cols,&rows)<0){
+			printf("This type of regenerating code is not supported. \n");
+			return(-1);
+		}
+		offset = add_section(header.sections+3*i,offset,matrices[i]==NULL?0:(long long)cols*rows);
+		offset = add_section(header.sections+3*i+1,offset,bitmatrices[i]==NULL?0:jerasure_packed_bitmatrix_words(cols,rows,w));
+		offset = add_section(header.sections+3*i+2,offset,schedules[i]==NULL?0:schedules[i]->size);
+	}
+	header.file_size = offset;
+
+	fp = fopen(path,"wb");
+	if(fp==NULL){
+		printf("Can not open %s\n", path);
+		return(-1);
+	}
+	if(fwrite(&header,sizeof(header),1,fp)!=1)
+		ret = -1;
+	for(i=0;i<=info->num_of_submatrices&&ret>0;i++){
+		if(write_section(fp,header.sections+3*i,matrices[i])<0
+			||write_section(fp,header.sections+3*i+1,(int*)bitmatrices[i])<0
+			||write_section(fp,header.sections+3*i+2,schedules[i]==NULL?NULL:schedules[i]->data)<0)
+			ret = -1;
+	}
+	// pad the file to its full size
+	if(ret>0&&(fseek(fp,header.file_size-1,SEEK_SET)!=0||fputc(0,fp)==EOF))
+		ret = -1;
+	if(fclose(fp)!=0)
+		ret = -1;
+	if(ret<0)
+		printf("Can not write %s\n", path);
+	return(ret);
+}
+
+// the schedule of the coding matrix (index 0) or of submatrix index-1, checked against the size of that matrix
+static struct jerasure_flat_schedule* map_schedule(struct coding_info *info, char *base, struct coding_info_section *section, int index)
+{
+	int cols, rows;
+
+	if(section->count==0||section->count>INT_MAX||get_matrix_size(info,index,&cols,&rows)<0)
+		return(NULL);
+	return(jerasure_map_flat_schedule((int*)(base+section->offset),section->count,cols+rows,info->req.w));
+}
+
+// number of submatrices make_coding_matrics() makes for a type of code
+static int get_num_of_submatrices(enum codetype type)
+{
+	switch (type)
+	{
+		case MBR_PRODUCTMATRIX:
+			return(2);
+		case MSR_PRODUCTMATRIX:
+			return(5);
+		default:
+			return(0);
+	}
+}
+
+// checks that the requirement of a file is the one get_requirement() makes for its parameters, and that the file has
+// every table of the code, with the sizes of the parameters, at aligned offsets past the header and within the file.
+// The schedules are checked when they are mapped.
+static int check_coding_info_sections(struct coding_info_file_header *header, struct coding_info *info)
+{
+	int i, cols, rows;
+	long long count;
+	struct requirement expected;
+	struct requirement *req = &header->req;
+	struct coding_info_section *section;
+	int num_of_tables = 3*(get_num_of_submatrices(req->type)+1);
+
+	// SRC and LRC take f in place of d
+	if(get_requirement(req->type,&expected,req->n,req->k,(req->type==SRC||req->type==LRC)?req->f:req->d,req->w)<0)
+		return(-1);
+	if(req->min_size!=expected.min_size||req->max_size!=expected.max_size||req->multiple_of!=expected.multiple_of
+		||req->n!=expected.n||req->k!=expected.k||req->d!=expected.d||req->w!=expected.w||req->inner_n!=expected.inner_n
+		||req->inner_k!=expected.inner_k||req->f!=expected.f||req->type!=expected.type
+		||header->num_of_submatrices!=get_num_of_submatrices(req->type))
+		return(-1);
+	for(i=0;i<NUM_OF_SECTIONS;i++){
+		section = header->sections+i;
+		if(i>=num_of_tables){
+			if(section->count!=0||section->offset!=0)
+				return(-1);
+			continue;
+		}
+		if(section->count<=0||section->offset<(long long)sizeof(struct coding_info_file_header)
+			||section->offset%WORKSPACE_ALIGNMENT!=0||section->offset>header->file_size
+			||section->count>(header->file_size-section->offset)/(long long)sizeof(int))
+			return(-1);
+		// matrices and bitmatrices are read with the sizes of the parameters
+		if(i%3==2)
+			continue;
+		if(get_matrix_size(info,i/3,&cols,&rows)<0)
+			return(-1);
+		count = i%3==0?(long long)cols*rows:jerasure_packed_bitmatrix_words(cols,rows,info->req.w);
+		if(section->count!=count)
+			return(-1);
+	}
+	return(1);
 }
 
+// maps a file written by save_coding_info() instead of calling make_coding_matrics(). info->req must be set 
+// (e.g., by get_requirement) and has to match the parameters the file was made with. The backend of info is the one 
+// the file was saved with, and can not be changed.
+int load_coding_info(const char *path, struct coding_info *info)
+{
+	int i, fd;
+	struct stat st;
+	char *base;
+	struct coding_info_file_header *header;
+	struct requirement *req;
+
+	fd = open(path,O_RDONLY);
+	if(fd<0)
+		return(-1);
+	if(fstat(fd,&st)<0||st.st_size<(off_t)sizeof(struct coding_info_file_header)){
+		close(fd);
+		return(-1);
+	}
+	base = mmap(NULL,st.st_size,PROT_READ,MAP_SHARED,fd,0);
+	close(fd);
+	if(base==MAP_FAILED)
+		return(-1);
+
+	header = (struct coding_info_file_header*)base;
+	req = &header->req;
+	if(memcmp(header->magic,CODING_INFO_MAGIC,sizeof(CODING_INFO_MAGIC))!=0||header->version!=CODING_INFO_VERSION
+		||header->byte_order!=CODING_INFO_BYTE_ORDER||header->int_size!=sizeof(int)||header->file_size!=st.st_size
+		||(header->backend!=BITMATRIX_BACKEND&&header->backend!=MATRIX_BACKEND)){
+		printf("%s is not a valid coding info file.\n", path);
+		munmap(base,st.st_size);
+		return(-1);
+	}
+	if(req->type!=info->req.type||req->n!=info->req.n||req->k!=info->req.k||req->d!=info->req.d||req->w!=info->req.w
+		||req->f!=info->req.f||req->inner_n!=info->req.inner_n||req->inner_k!=info->req.inner_k
+		||req->low_density!=info->req.low_density){
+		printf("%s was made for different coding parameters.\n", path);
+		munmap(base,st.st_size);
+		return(-1);
+	}
+	if(check_coding_info_sections(header,info)<0){
+		printf("%s is not a valid coding info file.\n", path);
+		munmap(base,st.st_size);
+		return(-1);
+	}
 
+	info->req = *req;
+	info->repair_cache = NULL;
+	info->workspace_pool = NULL;
+	info->table_lock = NULL;
+	info->compiled_array = NULL;
+	info->lambda = NULL;
+	info->mapping = base;
+	info->mapping_size = st.st_size;
+	info->num_of_submatrices = header->num_of_submatrices;
+	info->matrix = header->sections[0].count?(int*)(base+header->sections[0].offset):NULL;
+	info->bitmatrix = header->sections[1].count?(unsigned int*)(base+header->sections[1].offset):NULL;
+	info->schedule = map_schedule(info,base,header->sections+2,0);
+	info->submatrix_array = NULL;
+	info->subbitmatrix_array = NULL;
+	info->subschedule_array = NULL;
+	if(info->num_of_submatrices>0){
+		info->submatrix_array = calloc(info->num_of_submatrices,sizeof(int*));
+		info->subbitmatrix_array = calloc(info->num_of_submatrices,sizeof(unsigned int*));
+		info->subschedule_array = calloc(info->num_of_submatrices,sizeof(struct jerasure_flat_schedule*));
+		if(info->submatrix_array==NULL||info->subbitmatrix_array==NULL||info->subschedule_array==NULL){
+			printf("Can not allocate memory\n");
+			cleanup_matrics(info);
+			return(-1);
+		}
+		for(i=0;i<info->num_of_submatrices;i++){
+			info->submatrix_array[i] = header->sections[3*i+3].count?(int*)(base+header->sections[3*i+3].offset):NULL;
+			info->subbitmatrix_array[i] = header->sections[3*i+4].count?(unsigned int*)(base+header->sections[3*i+4].offset):NULL;
+			info->subschedule_array[i] = map_schedule(info,base,header->sections+3*i+5,i+1);
+			if(info->subschedule_array[i]==NULL&&header->sections[3*i+5].count>0){
+				printf("%s has an invalid schedule or memory can not be allocated.\n", path);
+				cleanup_matrics(info);
+				return(-1);
+			}
+		}
+	}
+	if(info->schedule==NULL&&header->sections[2].count>0){
+		printf("%s has an invalid schedule or memory can not be allocated.\n", path);
+		cleanup_matrics(info);
+		return(-1);
+	}
+	if(make_runtime_state(info)<0||set_coding_backend(info,(enum coding_backend)header->backend)<0){
+		cleanup_matrics(info);
+		return(-1);
+	}
+	// the file was made for data coded with its backend
+	info->coded_backend = header->backend;
+	return(1);
+}
@@ -25,9 +25,14 @@ THIS SOFTWARE IS PROVIDED BY AT&T INTELLECTUAL PROPERTY ''AS IS'' AND ANY EXPRES
 #ifndef CODING_REGENERATING
 #define CODING_REGENERATING
 
+#include <pthread.h>
 #include "galois.h"
+#include "thread_pool.h"
+#include "xor_kernels.h"
 #define MAXPACKETSIZE (67108864)
 #define ALIGNMENT 512
+#define REPAIR_CACHE_SIZE 16
+#define WORKSPACE_ALIGNMENT 64
 
 enum codetype{
 	MBR_REPAIRBYTRANSFER,
@@ -38,6 +43,14 @@ enum codetype{
 	STEINERCODE
 };
 
+// how the GF(2^w) linear combinations of the regions are computed: with XOR schedules of the bitmatrices (any w), 
+// or by multiplying whole regions by field elements with the SIMD tables of GF-Complete (w=8, 16 or 32). The two 
+// lay out the words of a packet differently, so data coded with one can only be decoded and repaired with the same.
+enum coding_backend{
+	BITMATRIX_BACKEND,
+	MATRIX_BACKEND
+};
+
 struct requirement
 {
 	int min_size;
@@ -48,23 +61,163 @@ struct requirement
 	//extended fields
 	int inner_n, inner_k;
 	int f; //used by SRC and LRC
+	int low_density; //MSR and MBR product-matrix codes: search for a coding matrix with few bitmatrix ones, 0 by default
+
+	enum codetype type;
+};
+
+// the repair coefficients for a given newcomer and an ordered set of d helpers
+struct repair_entry
+{
+	int to_device_ID;
+	int* helpers;		// the d helper IDs, in the order the repair data is given
+	int* matrix;		// final repair matrix, from the d helper packets to the repaired packet
+	int* bitmatrix;		// bitmatrix of the matrix above, only made for the bitmatrix backend
+	int** schedule;		// schedule of the bitmatrix above
+	int refs;		// number of callers currently using this entry
+	int cached;		// 0 if the entry was not kept in the cache and is freed when refs drops to 0
+	unsigned long last_used;
+};
+
+// bounded cache of repair entries, with least recently used replacement
+struct repair_cache
+{
+	pthread_mutex_t lock;
+	int num_of_entries;
+	unsigned long clock;
+	struct repair_entry* entries[REPAIR_CACHE_SIZE];
+};
+
+// scratch memory of one thread, handed out stack-like with workspace_alloc() and given back with 
+// workspace_release(). What does not fit is allocated separately, and the buffer is enlarged to the 
+// peak usage once everything is released, so that the same calls later run without any allocation.
+struct workspace_chunk
+{
+	size_t mark;		// workspace usage when this chunk was allocated
+	struct workspace_chunk* next;
+};
+
+struct workspace
+{
+	char* buffer;
+	size_t size;
+	size_t used;
+	size_t peak;
+	struct workspace_chunk* overflow;
+	struct workspace* next;	// next workspace of the same coding_info
+};
+
+// the workspaces of all threads using a coding_info
+struct workspace_pool
+{
+	pthread_key_t key;
+	pthread_mutex_t lock;
+	struct workspace* list;
+};
+
+struct decode_plan;
 
+// a schedule compiled into straight-line code by schedule_compiler, called in place of jerasure_do_flat_operations().
+// It makes the same xor_regions() calls, without the dispatch of the interpreter.
+// temps holds the num_of_temps temporary packets of the schedule, it is NULL if there are none.
+typedef void (*compiled_schedule)(char **ptrs, char *temps, int packetsize);
+
+// the compiled schedules of a configuration, of matrix index (0 for the coding matrix, i+1 for submatrix i). 
+// matrix_hash, see get_matrix_hash(), guards against a library making other matrices.
+struct compiled_schedule_entry
+{
 	enum codetype type;
+	int n,k,d,w;
+	unsigned int matrix_hash;
+	int index;
+	int num_of_temps;
+	compiled_schedule function;
 };
 
+// the registry made by schedule_compiler (compiled_schedules.c), ended by an entry with a NULL function
+extern struct compiled_schedule_entry compiled_schedules[];
+
+struct jerasure_flat_schedule;	// see jerasure_add.h
+
 struct coding_info
 {
 	struct requirement req;
+	enum coding_backend backend;	// BITMATRIX_BACKEND unless changed with set_coding_backend()
+	int coded_backend;		// backend of the coded data, -1 until the first coding, see set_coding_backend()
+	int optimize_schedules;		// 0 unless changed with set_schedule_optimization()
+	int collapsed_decoding;		// 0 unless changed with set_collapsed_decoding()
+	int tile_bytes;			// working set of a decoding tile, see set_tile_bytes()
+	long long memory_budget;	// scratch memory of an MSR decoding, 0 unless changed with set_memory_budget()
 	int* matrix;
-	int* bitmatrix;
-	int** schedule;
+	int* lambda;			// MSR product-matrix codes: \lambda_i of device i, i.e., the ratio of columns 0 and k-1 of its row
+	unsigned int* bitmatrix;	// packed (see jerasure_add.h), built on first use, see get_bitmatrix()
+	struct jerasure_flat_schedule* schedule;	// built on first use, see get_schedule()
 	// extended fields of submatrix for more sophisticated coding algorithms
 	int num_of_submatrices;
 	int** submatrix_array; 
-	int** subbitmatrix_array;
-	int*** subschedule_array;
+	unsigned int** subbitmatrix_array;	// bitmatrix and schedule fields are NULL until first used,
+	struct jerasure_flat_schedule** subschedule_array;	// always read them with get_bitmatrix(), get_subschedule(), etc.
+	// compiled form of the schedule of the coding matrix (index 0) and of submatrix i (index i+1), NULL entries 
+	// are interpreted. NULL if no schedule of this configuration was compiled.
+	struct compiled_schedule_entry** compiled_array;
+	// repair coefficients of the recent (to_device_ID, helpers) pairs
+	struct repair_cache* repair_cache;
+	// per thread scratch memory for encoding, decoding and repair
+	struct workspace_pool* workspace_pool;
+	// guards the lazy construction of the bitmatrices and schedules
+	pthread_mutex_t* table_lock;
+	// non-NULL if the matrices were mapped from a file by load_coding_info()
+	void* mapping;
+	size_t mapping_size;
+};
+
+// everything in decoding that only depends on the erasure pattern. A plan is made once 
+// and can then be used to decode any number of stripes with the same erasures.
+struct decode_plan
+{
+	int* erasures;	// copy of the erasure list, terminated by -1
+	int* erased;	// erased[i]==1 if device i is erased
+	int* remaining;	// the first k devices that are not erased
+	// code specific decoding schedules, each with the (pseudo) erasure list it was generated for, and the schedules of
+	// make_plan_encoding()
+	int num_of_schedules;
+	int** erasures_array;
+	int** erased_array;	// erased form of erasures_array, NULL entries are plan->erased
+	struct jerasure_flat_schedule** schedule_array;
+	// with the matrix backend, the decoding rows and their source devices replace the schedules, 
+	// see jerasure_make_decoding_rows(), and the matrix itself replaces the schedules of make_plan_encoding()
+	enum coding_backend backend;
+	int** matrix_array;
+	int** src_ids_array;
+	// codes that decode in several phases can instead rebuild the erased data subpackets as one linear map of the 
+	// subpackets of the remaining devices, see set_collapsed_decoding(). collapsed_cols is 0 if the plan has no such
+	// map; its matrix is kept for the matrix backend and its schedule for the bitmatrix backend.
+	int collapsed_cols, collapsed_rows;
+	int* collapsed_matrix;
+	struct jerasure_flat_schedule* collapsed_schedule;
 };
 
+
+// called with each complete coded packet of device device_ID when encoding, and with the decoded data 
+// (device_ID=-1) when decoding. Returns a negative value to stop the stream.
+typedef int (*rc_stream_write)(void *arg, int device_ID, char *buffer, size_t size);
+
+// state of encoding or decoding an object one stripe at a time, see init_encode_stream()
+struct rc_stream
+{
+	struct coding_info* info;
+	int decoding;
+	long long object_size;	// bytes of the object: given when decoding, counted so far when encoding
+	long long done;		// data bytes of the object coded so far
+	int stripe_size;	// data bytes of every stripe but the last one
+	long long packet_size;	// bytes per device of a full stripe
+	int fill;		// bytes of the current stripe received: data when encoding, per device when decoding
+	char* data;		// data of the current stripe
+	char** coded;		// packets of the current stripe
+	struct decode_plan* plan;
+	rc_stream_write write;
+	void* arg;
+};
 	
 
 #define MIN(a,b) (((a)<(b))?(a):(b))
@@ -72,11 +225,60 @@ struct coding_info
 
 #define talloc(type, num) (type *) malloc(sizeof(type)*(num))
 
+// the production configurations, for which the layout loops of the codecs are also compiled with constant parameters:
+// each codec has an always-inlined body taking the parameters as arguments, which its entry point calls once per 
+// configuration below with constants, and otherwise with the values of info->req. Keep them in step with COMPILED_CODES 
+// in the makefile.
+#define SPECIALIZED_LRC(X) X(12,8,2)		// n, k, f
+#define SPECIALIZED_SRC(X) X(12,8,3)		// n, k, f
+#define SPECIALIZED_MSR(X) X(12,4,8,8)		// n, k, d, w
+#define SPECIALIZED_MBR_RBT(X) X(6,3)		// n, k
+#define SPECIALIZABLE static inline __attribute__((always_inline))
+
 int get_requirement(enum codetype type, struct requirement *req, int n, int k, int d, int w);
-int compute_coded_packet_size(struct requirement *req, int data_size);
-int compute_repair_packet_size(struct requirement *req, int data_size);
+long long compute_coded_packet_size(struct requirement *req, long long data_size);
+long long compute_repair_packet_size(struct requirement *req, long long data_size);
 int make_coding_matrics(struct coding_info *info);
 void cleanup_matrics(struct coding_info *info);
+unsigned int* get_bitmatrix(struct coding_info *info);
+struct jerasure_flat_schedule* get_schedule(struct coding_info *info);
+unsigned int* get_subbitmatrix(struct coding_info *info, int index);
+struct jerasure_flat_schedule* get_subschedule(struct coding_info *info, int index);
+int set_coding_backend(struct coding_info *info, enum coding_backend backend);
+void set_schedule_optimization(struct coding_info *info, int optimize);
+void set_collapsed_decoding(struct coding_info *info, int collapse);
+void set_tile_bytes(struct coding_info *info, int bytes);
+void set_memory_budget(struct coding_info *info, long long bytes);
+int get_tile_length(struct coding_info *info, int length, int bytes_per_byte, int scratch_per_byte);
+int get_schedule_xors(struct coding_info *info, int index, int *unoptimized);
+unsigned int get_matrix_hash(struct coding_info *info);
+// the coding primitives of the codes, computed with the backend of info. index is 0 for the coding matrix and 
+// i+1 for submatrix i; with the bitmatrix backend, its schedule (or bitmatrix for the dotprods) must have 
+// been built already, e.g., with get_schedule(). encode_by_matrix() and decode_by_collapsed_plan() return -1 if
+// the scratch of an optimized schedule can not be allocated.
+int encode_by_matrix(int index, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info);
+void dotprod_by_matrix(int index, int row, char **data_ptrs, char *dest, int length, struct coding_info *info);
+void dotprod_rows_by_matrix(int index, int *rows, int num_rows, char **data_ptrs, char **dests, int length, int add, struct coding_info *info);
+void encode_by_entry(struct repair_entry *entry, int k, int m, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info);
+int make_plan_decoding(struct decode_plan *plan, int schedule_index, int index, int *erasures, struct coding_info *info);
+void decode_by_plan(struct decode_plan *plan, int schedule_index, int k, int m, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info);
+int make_plan_decoding_by_matrix(struct decode_plan *plan, int schedule_index, int *matrix, int cols, int rows, int *erasures, struct coding_info *info);
+int make_plan_encoding(struct decode_plan *plan, int schedule_index, int *matrix, int cols, int rows, struct coding_info *info);
+void encode_by_plan(struct decode_plan *plan, int schedule_index, int k, int m, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info);
+int make_plan_collapsed(struct decode_plan *plan, int *matrix, int cols, int rows, struct coding_info *info);
+int decode_by_collapsed_plan(struct decode_plan *plan, char **data_ptrs, char **coding_ptrs, char **ptrs, int length, struct coding_info *info);
+int save_coding_info(const char *path, struct coding_info *info);
+int load_coding_info(const char *path, struct coding_info *info);
+struct decode_plan* make_decode_plan(int* erasures, struct coding_info *info);
+void free_decode_plan(struct decode_plan *plan);
+struct repair_entry* get_repair_entry(int to_device_ID, int* helpers, struct coding_info *info,
+	int (*make_entry)(struct repair_entry *entry, struct coding_info *info));
+void put_repair_entry(struct repair_entry *entry, struct coding_info *info);
+struct workspace* get_workspace(struct coding_info *info);
+void release_workspace(struct coding_info *info);
+void* workspace_alloc(struct workspace *ws, size_t size);
+size_t workspace_mark(struct workspace *ws);
+void workspace_release(struct workspace *ws, size_t mark);
 
 //int encode(void *input, size_t inputsize, void **output, size_t outputsize, struct CodingInfo *info);
 //int CheckValid(size_t inputsize, size_t outputsize, int packetsize, struct PacketSizeRequirement *requirement, int w);
@@ -86,37 +288,121 @@ void cleanup_matrics(struct coding_info *info);
 // MBR repair by transfer code
 int encode_MBR_repair_by_transfer(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info);
 int decode_MBR_repair_by_transfer(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info);
+int decode_MBR_repair_by_transfer_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info);
+int make_decode_plan_MBR_repair_by_transfer(struct decode_plan *plan, struct coding_info *info);
 int repair_encode_MBR_repair_by_transfer(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info);
 int repair_decode_MBR_repair_by_transfer(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info);
+int encode_MBR_repair_by_transfer_iov(char **data, char **output, int subpacket_size, int length, struct coding_info *info);
+int decode_MBR_repair_by_transfer_iov(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info);
+int repair_encode_MBR_repair_by_transfer_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info);
+int repair_decode_MBR_repair_by_transfer_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info);
 
 // Simple regenerating code
 int encode_SRC(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info);
 int decode_SRC(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info);
+int decode_SRC_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info);
+int make_decode_plan_SRC(struct decode_plan *plan, struct coding_info *info);
 int repair_encode_SRC(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info);
 int repair_decode_SRC(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info);
+int encode_SRC_iov(char **data, char **output, int subpacket_size, int length, struct coding_info *info);
+int decode_SRC_iov(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info);
+int repair_encode_SRC_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info);
+int repair_decode_SRC_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info);
 
 // Local regenerating code
 int encode_LRC(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info);
 int decode_LRC(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info);
+int decode_LRC_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info);
+int make_decode_plan_LRC(struct decode_plan *plan, struct coding_info *info);
 int repair_encode_LRC(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info);
 int repair_decode_LRC(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info);
+int encode_LRC_iov(char **data, char **output, int subpacket_size, int length, struct coding_info *info);
+int decode_LRC_iov(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info);
+int repair_encode_LRC_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info);
+int repair_decode_LRC_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info);
 
 // MBR code based on product matrix
 int encode_MBR_product_matrix(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info);
 int decode_MBR_product_matrix(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info);
+int decode_MBR_product_matrix_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info);
+int make_decode_plan_MBR_product_matrix(struct decode_plan *plan, struct coding_info *info);
 int repair_encode_MBR_product_matrix(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info);
 int repair_decode_MBR_product_matrix(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info);
+int encode_MBR_product_matrix_iov(char **data, char **output, int subpacket_size, int length, struct coding_info *info);
+int decode_MBR_product_matrix_iov(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info);
+int repair_encode_MBR_product_matrix_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info);
+int repair_decode_MBR_product_matrix_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info);
+int* search_MBR_product_matrix(struct coding_info *info);
 
 // MSR code based on product matrix
 int encode_MSR_product_matrix(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info);
 int decode_MSR_product_matrix(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info);
+int decode_MSR_product_matrix_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info);
+int make_decode_plan_MSR_product_matrix(struct decode_plan *plan, struct coding_info *info);
 int repair_encode_MSR_product_matrix(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info);
 int repair_decode_MSR_product_matrix(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info);
+int encode_MSR_product_matrix_iov(char **data, char **output, int subpacket_size, int length, struct coding_info *info);
+int decode_MSR_product_matrix_iov(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info);
+int repair_encode_MSR_product_matrix_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info);
+int repair_decode_MSR_product_matrix_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info);
+void make_MSR_product_matrix_row(int x, int *row, int k, int d, int w);
+int search_MSR_product_matrix(int *matrix, struct coding_info *info);
+int* make_MSR_systematic_generator(struct coding_info *info);
 
 int encode_rc(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info);
+// decoding uses input[i] of the erased devices as scratch, and what is left there depends on the code and the plan:
+// the MSR phases leave the rebuilt device, a collapsed plan (see set_collapsed_decoding()) leaves it untouched.
 int decode_rc(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info);
+int decode_rc_with_plan(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info);
+// decoding that never writes to input, e.g., read-only mappings of the device files. input[i] of the erased 
+// devices is not used and can be NULL.
+int decode_rc_read_only(const char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info);
+int decode_rc_with_plan_read_only(const char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct coding_info *info);
 int repair_encode_rc(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info);
 int repair_decode_rc(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info);
+int encode_rc_region(char *input, char **output, int subpacket_size, int length, struct coding_info *info);
+int decode_rc_region(char **input, char *output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info);
+int repair_encode_rc_region(char *input, char *output, int subpacket_size, int length, int from_device_ID, int to_device_ID, struct coding_info *info);
+int repair_decode_rc_region(char **input, char *output, int subpacket_size, int length, int to_device_ID, int* helpers, struct coding_info *info);
+
+/* Scatter-gather coding. The data of a stripe is cut into get_num_of_data_subpackets() subpackets of
+subpacket_size bytes, given as an array of pointers, data[j] being the j-th subpacket. get_data_layout() tells
+where each data subpacket is stored on the systematic devices. If data[j] already points there, e.g., the 
+caller read the data into the device buffers, encoding does not copy it. Decoding writes data subpacket j to
+output[j], or if output[j] is NULL, sets it to where the subpacket is in the input buffers without copying. */
+int get_num_of_data_subpackets(struct requirement *req);
+int get_subpackets_per_device(struct requirement *req);
+int get_data_layout(struct requirement *req, int *device_ID, int *position);
+int encode_rc_iov(char **data, char **output, size_t output_size, struct coding_info *info);
+int decode_rc_iov(char **input, size_t input_size, char **output, int* erasures, struct coding_info *info);
+int decode_rc_iov_with_plan(char **input, size_t input_size, char **output, struct decode_plan *plan, struct coding_info *info);
+int encode_rc_iov_region(char **data, char **output, int subpacket_size, int length, struct coding_info *info);
+int decode_rc_iov_region(char **input, char **output, int subpacket_size, int length, struct decode_plan *plan, struct coding_info *info);
+char** get_subpacket_ptrs(struct workspace *ws, char *buffer, int num, int subpacket_size);
+void copy_region(char *dest, char *src, int length);
+void place_region(char **dest, char *src, int length);
+
+// parallel versions of encode_rc(), decode_rc(), etc., with the work split over the threads of pool, or done by the caller if pool is NULL
+int encode_rc_parallel(char *input, size_t input_size, char **output, size_t output_size, struct thread_pool *pool, struct coding_info *info);
+int decode_rc_parallel(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct thread_pool *pool, struct coding_info *info);
+int decode_rc_with_plan_parallel(char **input, size_t input_size, char *output, size_t output_size, struct decode_plan *plan, struct thread_pool *pool, struct coding_info *info);
+int repair_encode_rc_parallel(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct thread_pool *pool, struct coding_info *info);
+int repair_decode_rc_parallel(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct thread_pool *pool, struct coding_info *info);
+// num_of_stripes stripes of the same sizes, stripe i being input[i] and output[i]. Decoding uses the same erasures 
+// for all the stripes. The stripes are shared among the threads of pool, or all coded by the caller if pool is NULL.
+int encode_rc_batch(char **input, size_t input_size, char ***output, size_t output_size, int num_of_stripes, struct thread_pool *pool, struct coding_info *info);
+int decode_rc_batch(char ***input, size_t input_size, char **output, size_t output_size, int num_of_stripes, int* erasures, struct thread_pool *pool, struct coding_info *info);
+// stripe_size is a multiple of req.multiple_of no larger than req.max_size, or 0 for the largest such size of at most
+// 4MB (req.multiple_of if that is larger). A stream holds one stripe and its coded packets in memory. The same 
+// stripe_size has to be given to decode as to encode.
+// Encoding takes the object in pieces of any size with feed_encode_stream(), decoding takes the next size bytes 
+// of every device with feed_decode_stream(), input[i] of the erased devices being ignored.
+int init_encode_stream(struct rc_stream *stream, int stripe_size, rc_stream_write write, void *arg, struct coding_info *info);
+int init_decode_stream(struct rc_stream *stream, long long object_size, int stripe_size, int* erasures, rc_stream_write write, void *arg, struct coding_info *info);
+int feed_encode_stream(struct rc_stream *stream, char *input, size_t size);
+int feed_decode_stream(struct rc_stream *stream, char **input, size_t size);
+int finish_stream(struct rc_stream *stream);
+void cleanup_stream(struct rc_stream *stream);
 
 
 #endif //CODING_REGENERATING
@@ -0,0 +1,148 @@
+/* 
+
+# schedule_compiler.c - compiles the coding schedules of given configurations into straight-line C
+
+Copyright (c) 2026, the RegeneratingCodes contributors.
+
+Written for RegeneratingCodes after its original release, and distributed under the same terms as the rest
+of it, see LICENSE.
+
+# $Revision: 0.1 $
+# $Date: 2026/10/17 $
+*/
+
+/*
+Usage: schedule_compiler [-O] "type n k w v" ... > compiled_schedules.c
+
+type, n, k, w and v are as given to tester. For every configuration, the schedules that the bitmatrix backend 
+interprets (those of the coding matrix and the submatrices) are written out as C functions doing the same 
+operations, and a registry of them is written at the end, in which make_coding_matrics() finds them. 
+
+The schedules are compiled from their flat form (see jerasure_add.h), so every run of operations with the same 
+destination becomes a single xor_regions() call, which reads all its sources in one pass over the destination.
+That is the same call that jerasure_do_flat_operations() makes for such a run, so compiling only removes the
+interpreter's work of walking the schedule and computing the addresses of the operands. The XORs themselves run
+in the same kernels, and no loops are fused or unrolled beyond what xor_regions() does.
+With -O, the coding matrices are scheduled with jerasure_optimized_bitmatrix_to_schedule(), as after 
+set_schedule_optimization(info, 1), which saves XORs; the XOR counts with and without it are written above each 
+function.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "jerasure.h"
+#include "jerasure_add.h"
+#include "regenerating_codes.h"
+
+// this program is linked without a registry of its own
+struct compiled_schedule_entry compiled_schedules[] = {{.function = NULL}};
+
+struct compiled_function
+{
+	enum codetype type;
+	int n, k, d, w;
+	unsigned int matrix_hash;
+	int index;
+	int num_of_temps;
+	char name[64];
+};
+
+static struct compiled_function *functions = NULL;
+static int num_of_functions = 0;
+
+static void print_packet(struct jerasure_flat_schedule *schedule, int id, int packet)
+{
+	if(id==schedule->temp_id)
+		printf("temps+%d*packetsize", packet);
+	else
+		printf("ptrs[%d]+%d*packetsize", id, packet);
+}
+
+// unoptimized is the XOR count of the smart schedule of Jerasure
+static int compile_schedule(struct jerasure_flat_schedule *schedule, int unoptimized, struct coding_info *info, int index)
+{
+	int r, j;
+	struct compiled_function *function;
+
+	if(schedule==NULL)
+		return(-1);
+	functions = realloc(functions, sizeof(struct compiled_function)*(num_of_functions+1));
+	if(functions==NULL){
+		printf("Can not allocate memory\n");
+		return(-1);
+	}
+	function = functions+num_of_functions;
+	function->type = info->req.type;
+	function->n = info->req.n;
+	function->k = info->req.k;
+	function->d = info->req.d;
+	function->w = info->req.w;
+	function->matrix_hash = get_matrix_hash(info);
+	function->index = index;
+	function->num_of_temps = schedule->num_of_temps;
+	sprintf(function->name, "schedule_%d_%d_%d_%d_%d_matrix%d", info->req.type, info->req.n, info->req.k, info->req.d,
+		info->req.w, index);
+	num_of_functions++;
+
+	printf("\n");
+	printf("// %d XORs, %d with the smart schedule of Jerasure\n", jerasure_flat_schedule_xors(schedule), unoptimized);
+	// temps, the temporaries of one packet group (device temp_id of the schedule), is scratch of the caller
+	printf("static void %s(char **ptrs, char *temps, int packetsize)\n{\n", function->name);
+	printf("\tchar *src[%d];\n", MAX(schedule->max_run,1));
+	for(r=0;r<schedule->num_of_runs;r++){
+		for(j=schedule->first_src[r];j<schedule->first_src[r+1];j++){
+			printf("\tsrc[%d] = ", j-schedule->first_src[r]);
+			print_packet(schedule, schedule->src_id[j], schedule->src_packet[j]);
+			printf(";\n");
+		}
+		printf("\txor_regions(src, %d, ", schedule->first_src[r+1]-schedule->first_src[r]);
+		print_packet(schedule, schedule->dest_id[r], schedule->dest_packet[r]);
+		printf(", packetsize, %d);\n", schedule->add[r]);
+	}
+	printf("}\n");
+	return(1);
+}
+
+int main(int argc, char **argv)
+{
+	int i, j, n, k, w, v, type, unoptimized, optimize = 0;
+	enum codetype types[5] = {LRC, SRC, MSR_PRODUCTMATRIX, MBR_PRODUCTMATRIX, MBR_REPAIRBYTRANSFER};
+	struct coding_info info;
+
+	printf("/* made by schedule_compiler, do not edit */\n\n");
+	printf("#include \"regenerating_codes.h\"\n");
+	if(argc>1&&strcmp(argv[1],"-O")==0){
+		optimize = 1;
+		argv++;
+		argc--;
+	}
+	for(i=1;i<argc;i++){
+		v = -1;
+		if(sscanf(argv[i], "%d %d %d %d %d", &type, &n, &k, &w, &v)<4||type<0||type>4){
+			fprintf(stderr, "schedule_compiler: can not parse \"%s\"\n", argv[i]);
+			return(1);
+		}
+		if(v<0)
+			v = n-1;
+		if(get_requirement(types[type], &info.req, n, k, v, w)<0||make_coding_matrics(&info)<0){
+			fprintf(stderr, "schedule_compiler: invalid configuration \"%s\"\n", argv[i]);
+			return(1);
+		}
+		set_schedule_optimization(&info, optimize);
+		for(j=0;j<=info.num_of_submatrices;j++){
+			if(get_schedule_xors(&info, j, &unoptimized)<0
+				||compile_schedule(j==0?get_schedule(&info):get_subschedule(&info, j-1), unoptimized, &info, j)<0)
+				return(1);
+		}
+		cleanup_matrics(&info);
+	}
+
+	printf("\nstruct compiled_schedule_entry compiled_schedules[] = {\n");
+	for(i=0;i<num_of_functions;i++)
+		printf("\t{%d, %d, %d, %d, %d, %uu, %d, %d, %s},\n", functions[i].type, functions[i].n, functions[i].k, functions[i].d,
+			functions[i].w, functions[i].matrix_hash, functions[i].index, functions[i].num_of_temps, functions[i].name);
+	printf("\t{.function = NULL}\n};\n");
+	free(functions);
+	return(0);
+}
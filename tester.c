@@ -25,6 +25,7 @@ THIS SOFTWARE IS PROVIDED BY AT&T INTELLECTUAL PROPERTY ''AS IS'' AND ANY EXPRES
 #include <stdlib.h>
 #include <string.h>
 #include <time.h>
+#include <sys/mman.h>
 #include "jerasure.h"
 #include "cauchy.h"
 #include "regenerating_codes.h"
@@ -60,6 +61,391 @@ static void print_data_and_coding(int n, int size, void **data_plus_coding)
 char *data=NULL,*decoded_data=NULL, *repaired=NULL;  
 char **coded=NULL, **repair_data=NULL;  
 int *erasures=NULL, *erased=NULL;
+struct thread_pool *pool=NULL;	// set from RC_THREADS, then the parallel coding functions are tested instead of the serial ones
+
+static int test_encode(char *input, size_t input_size, char **output, size_t output_size, struct coding_info *info)
+{
+	if(pool!=NULL)
+		return(encode_rc_parallel(input, input_size, output, output_size, pool, info));
+	return(encode_rc(input, input_size, output, output_size, info));
+}
+
+static int test_decode(char **input, size_t input_size, char *output, size_t output_size, int* erasures, struct coding_info *info)
+{
+	if(pool!=NULL)
+		return(decode_rc_parallel(input, input_size, output, output_size, erasures, pool, info));
+	return(decode_rc(input, input_size, output, output_size, erasures, info));
+}
+
+static int test_repair_encode(char *input, size_t input_size, char *output, size_t output_size, int from_device_ID, int to_device_ID, struct coding_info *info)
+{
+	if(pool!=NULL)
+		return(repair_encode_rc_parallel(input, input_size, output, output_size, from_device_ID, to_device_ID, pool, info));
+	return(repair_encode_rc(input, input_size, output, output_size, from_device_ID, to_device_ID, info));
+}
+
+static int test_repair_decode(char **input, size_t input_size, char *output, size_t output_size, int to_device_ID, int* helpers, struct coding_info *info)
+{
+	if(pool!=NULL)
+		return(repair_decode_rc_parallel(input, input_size, output, output_size, to_device_ID, helpers, pool, info));
+	return(repair_decode_rc(input, input_size, output, output_size, to_device_ID, helpers, info));
+}
+
+void usage(char *s);
+
+static void fill_random(char *buffer, int size)
+{
+	int i;
+	long l;
+	for(i=0 ; i<size/sizeof(long); i++){
+		l = lrand48(); l = (l << 32) | lrand48();
+		memcpy((long*)(buffer+i*sizeof(long)), &l, sizeof(long));
+	}
+}
+
+static char** alloc_packets(int num, int size)
+{
+	int i;
+	char **packets = calloc(num, sizeof(char*));
+	if(packets==NULL)
+		return(NULL);
+	for(i=0;i<num;i++)
+		packets[i] = malloc(size);
+	return(packets);
+}
+
+static void free_packets(char **packets, int num)
+{
+	int i;
+	if(packets==NULL)
+		return;
+	for(i=0;i<num;i++)
+		free(packets[i]);
+	free(packets);
+}
+
+/* The checks selected with RC_CHECK, run once per repetition after the main test. Each codes with another entry
+point of the library and compares the result with encode_rc() and decode_rc() on the same data, returning -1 if 
+they differ. */
+
+#define NUM_CHECK_STRIPES 3
+
+// encode_rc_batch() against encode_rc() on each stripe, then decode_rc_batch() with the erasures of the test
+static int check_batch(int size_of_data, int coded_packet_size, struct coding_info *info)
+{
+	int i, j, ret = 1;
+	int n = info->req.n;
+	char *input[NUM_CHECK_STRIPES], *output[NUM_CHECK_STRIPES];
+	char **batch_coded[NUM_CHECK_STRIPES], **single_coded = alloc_packets(n, coded_packet_size);
+
+	for(i=0;i<NUM_CHECK_STRIPES;i++){
+		input[i] = malloc(size_of_data);
+		output[i] = malloc(size_of_data);
+		batch_coded[i] = alloc_packets(n, coded_packet_size);
+		fill_random(input[i], size_of_data);
+	}
+	if(encode_rc_batch(input, size_of_data, batch_coded, coded_packet_size, NUM_CHECK_STRIPES, pool, info)<0)
+		ret = -1;
+	for(i=0;i<NUM_CHECK_STRIPES&&ret>0;i++){
+		if(encode_rc(input[i], size_of_data, single_coded, coded_packet_size, info)<0)
+			ret = -1;
+		for(j=0;j<n&&ret>0;j++){
+			if(memcmp(single_coded[j], batch_coded[i][j], coded_packet_size))
+				ret = -1;
+		}
+	}
+	if(ret>0&&decode_rc_batch(batch_coded, coded_packet_size, output, size_of_data, NUM_CHECK_STRIPES, erasures, pool, info)<0)
+		ret = -1;
+	for(i=0;i<NUM_CHECK_STRIPES&&ret>0;i++){
+		if(memcmp(input[i], output[i], size_of_data))
+			ret = -1;
+	}
+	for(i=0;i<NUM_CHECK_STRIPES;i++){
+		free(input[i]);
+		free(output[i]);
+		free_packets(batch_coded[i], n);
+	}
+	free_packets(single_coded, n);
+	return(ret);
+}
+
+// collects what a stream writes: the coded packets of each device end to end, or the decoded data
+struct stream_sink
+{
+	char** device;
+	long long* device_size;
+	char* data;
+	long long data_size;
+};
+
+static int write_to_sink(void *arg, int device_ID, char *buffer, size_t size)
+{
+	struct stream_sink *sink = arg;
+	if(device_ID<0){
+		memcpy(sink->data+sink->data_size, buffer, size);
+		sink->data_size += size;
+	}
+	else{
+		memcpy(sink->device[device_ID]+sink->device_size[device_ID], buffer, size);
+		sink->device_size[device_ID] += size;
+	}
+	return(1);
+}
+
+// size of the next piece fed to a stream: zero-length, odd and larger than a stripe in turn
+static size_t get_piece_size(int piece, int stripe_size, long long left)
+{
+	size_t sizes[5] = {0, 1, 4093, stripe_size+stripe_size/2+7, stripe_size/3};
+	return(MIN((size_t)left, sizes[piece%5]));
+}
+
+// streams an object that is not a whole number of stripes through feed_encode_stream() in pieces of varying sizes, 
+// checks the packets of each stripe against encode_rc() on the stripe padded with zeros, then streams them back 
+// through feed_decode_stream(), the erased devices being NULL. With stripe_size=0 the default stripe size is used.
+static int check_stream_with(int size_of_data, int stripe_size, struct coding_info *info)
+{
+	int i, piece, ret = 1;
+	int n = info->req.n;
+	int multiple_of = info->req.multiple_of;
+	long long object_size = size_of_data+size_of_data/3+1;
+	long long coded_size = compute_coded_packet_size(&info->req, object_size+(long long)multiple_of*(object_size/multiple_of+1));
+	long long pos, stripe, stripe_data, packet_size, device_pos;
+	size_t size;
+	char *object = calloc(object_size, 1), *padded = NULL;
+	char **single_coded = NULL, **input = calloc(n, sizeof(char*));
+	struct rc_stream stream;
+	struct stream_sink sink;
+
+	memset(&sink, 0, sizeof(sink));
+	sink.device = alloc_packets(n, coded_size);
+	sink.device_size = calloc(n, sizeof(long long));
+	sink.data = malloc(object_size);
+	fill_random(object, object_size);
+	if(init_encode_stream(&stream, stripe_size, write_to_sink, &sink, info)<0)
+		ret = -1;
+	stripe_size = stream.stripe_size;
+	for(pos=0,piece=0;ret>0&&pos<object_size;piece++,pos+=size){
+		size = get_piece_size(piece, stripe_size, object_size-pos);
+		if(feed_encode_stream(&stream, object+pos, size)<0)
+			ret = -1;
+	}
+	if(ret>0&&(finish_stream(&stream)<0||stream.object_size!=object_size))
+		ret = -1;
+	cleanup_stream(&stream);
+
+	// the packets of every stripe are those of encode_rc()
+	padded = malloc(stripe_size);
+	single_coded = alloc_packets(n, compute_coded_packet_size(&info->req, stripe_size));
+	for(stripe=0,device_pos=0;ret>0&&stripe<object_size;stripe+=stripe_size,device_pos+=packet_size){
+		stripe_data = MIN(stripe_size, object_size-stripe);
+		memset(padded, 0, stripe_size);
+		memcpy(padded, object+stripe, stripe_data);
+		stripe_data = (stripe_data+multiple_of-1)/multiple_of*multiple_of;
+		packet_size = compute_coded_packet_size(&info->req, stripe_data);
+		if(encode_rc(padded, stripe_data, single_coded, packet_size, info)<0)
+			ret = -1;
+		for(i=0;i<n&&ret>0;i++){
+			if(sink.device_size[i]<device_pos+packet_size||memcmp(single_coded[i], sink.device[i]+device_pos, packet_size))
+				ret = -1;
+		}
+	}
+	for(i=0;i<n&&ret>0;i++){
+		if(sink.device_size[i]!=device_pos)
+			ret = -1;
+	}
+
+	// and decode back to the object
+	if(ret>0&&init_decode_stream(&stream, object_size, stripe_size, erasures, write_to_sink, &sink, info)<0)
+		ret = -1;
+	for(pos=0,piece=0;ret>0&&pos<device_pos;piece++,pos+=size){
+		size = get_piece_size(piece, stripe_size, device_pos-pos);
+		for(i=0;i<n;i++)
+			input[i] = erased[i]?NULL:sink.device[i]+pos;
+		if(feed_decode_stream(&stream, input, size)<0)
+			ret = -1;
+	}
+	if(ret>0&&(finish_stream(&stream)<0||sink.data_size!=object_size||memcmp(sink.data, object, object_size)))
+		ret = -1;
+	cleanup_stream(&stream);
+
+	free(object);
+	free(padded);
+	free(input);
+	free_packets(single_coded, n);
+	free_packets(sink.device, n);
+	free(sink.device_size);
+	free(sink.data);
+	return(ret);
+}
+
+static int check_stream(int size_of_data, struct coding_info *info)
+{
+	if(check_stream_with(size_of_data, info->req.multiple_of, info)<0)
+		return(-1);
+	return(check_stream_with(size_of_data, 0, info));
+}
+
+// encode_rc_iov() in place, the data subpackets being read into the device buffers where get_data_layout() puts them,
+// against encode_rc(), then decode_rc_iov() from the devices with the erased ones cleared, every other output being
+// NULL so that it is pointed into the input instead of copied
+static int check_iov(int size_of_data, int coded_packet_size, struct coding_info *info)
+{
+	int i, j, ret = 1;
+	int n = info->req.n;
+	int num = get_num_of_data_subpackets(&info->req);
+	int subpacket_size = coded_packet_size/get_subpackets_per_device(&info->req);
+	int *device_ID = malloc(sizeof(int)*num), *position = malloc(sizeof(int)*num);
+	char **data_ptrs = malloc(sizeof(char*)*num), **output = malloc(sizeof(char*)*num);
+	char *output_buffer = malloc(size_of_data);
+	char **devices = alloc_packets(n, coded_packet_size), **single_coded = alloc_packets(n, coded_packet_size);
+
+	get_data_layout(&info->req, device_ID, position);
+	for(j=0;j<num;j++){
+		data_ptrs[j] = devices[device_ID[j]]+position[j]*subpacket_size;
+		memcpy(data_ptrs[j], data+j*subpacket_size, subpacket_size);
+	}
+	if(encode_rc_iov(data_ptrs, devices, coded_packet_size, info)<0||encode_rc(data, size_of_data, single_coded, coded_packet_size, info)<0)
+		ret = -1;
+	for(i=0;i<n&&ret>0;i++){
+		if(memcmp(devices[i], single_coded[i], coded_packet_size))
+			ret = -1;
+	}
+	for(i=0;i<n;i++){
+		if(erased[i])
+			memset(devices[i], 0, coded_packet_size);
+	}
+	for(j=0;j<num;j++)
+		output[j] = j%2==0?NULL:output_buffer+j*subpacket_size;
+	if(ret>0&&decode_rc_iov(devices, coded_packet_size, output, erasures, info)<0)
+		ret = -1;
+	for(j=0;j<num&&ret>0;j++){
+		if(output[j]==NULL||memcmp(output[j], data+j*subpacket_size, subpacket_size))
+			ret = -1;
+		if(j%2==1&&output[j]!=output_buffer+j*subpacket_size)
+			ret = -1;
+	}
+	free(device_ID);
+	free(position);
+	free(data_ptrs);
+	free(output);
+	free(output_buffer);
+	free_packets(devices, n);
+	free_packets(single_coded, n);
+	return(ret);
+}
+
+// the memory budget of the last read-only decoding of check_read_only(), below what MSR decoding of the stripes in 
+// the makefile and gate needs, so that it rebuilds the erased parity in tiles
+#define READ_ONLY_BUDGET (2*1024*1024)
+
+// decode_rc_read_only() and decode_rc_with_plan_read_only() from devices mapped PROT_READ, so that any write to them
+// faults, the erased devices being NULL
+static int check_read_only(int size_of_data, int coded_packet_size, struct coding_info *info)
+{
+	int i, ret = 1;
+	long long budget = info->memory_budget;
+	int n = info->req.n;
+	const char **devices = calloc(n, sizeof(char*));
+	char **single_coded = alloc_packets(n, coded_packet_size);
+	char *output = malloc(size_of_data);
+	struct decode_plan *plan = make_decode_plan(erasures, info);
+	void *p;
+
+	if(plan==NULL||encode_rc(data, size_of_data, single_coded, coded_packet_size, info)<0)
+		ret = -1;
+	for(i=0;i<n&&ret>0;i++){
+		if(erased[i])
+			continue;
+		p = mmap(NULL, coded_packet_size, PROT_READ|PROT_WRITE, MAP_PRIVATE|MAP_ANONYMOUS, -1, 0);
+		if(p==MAP_FAILED){
+			ret = -1;
+			break;
+		}
+		memcpy(p, single_coded[i], coded_packet_size);
+		mprotect(p, coded_packet_size, PROT_READ);
+		devices[i] = p;
+	}
+	if(ret>0&&(decode_rc_read_only(devices, coded_packet_size, output, size_of_data, erasures, info)<0
+		||memcmp(output, data, size_of_data)))
+		ret = -1;
+	memset(output, 0, size_of_data);
+	if(ret>0&&(decode_rc_with_plan_read_only(devices, coded_packet_size, output, size_of_data, plan, info)<0
+		||memcmp(output, data, size_of_data)))
+		ret = -1;
+	memset(output, 0, size_of_data);
+	set_memory_budget(info, READ_ONLY_BUDGET);
+	if(ret>0&&(decode_rc_with_plan_read_only(devices, coded_packet_size, output, size_of_data, plan, info)<0
+		||memcmp(output, data, size_of_data)))
+		ret = -1;
+	set_memory_budget(info, budget);
+	for(i=0;i<n;i++){
+		if(devices[i]!=NULL)
+			munmap((void*)devices[i], coded_packet_size);
+	}
+	free(devices);
+	free(output);
+	free_packets(single_coded, n);
+	free_decode_plan(plan);
+	return(ret);
+}
+
+// switching the backend of a code: refused once info has coded data, and a plan made with the old backend is refused
+// by the decoding after a switch. Data coded with the matrix backend then decodes with it. Run once, and only for the
+// w the matrix backend supports.
+static int check_backend(int size_of_data, int coded_packet_size, struct coding_info *info)
+{
+	static int checked = 0;
+	int ret = 1;
+	int n = info->req.n;
+	int w = info->req.w;
+	enum coding_backend backend = info->backend;
+	struct coding_info fresh;
+	struct decode_plan *plan;
+	char **fresh_coded;
+	char *output;
+
+	if(checked||(w!=8&&w!=16&&w!=32))
+		return(1);
+	checked = 1;
+	if(set_coding_backend(info, backend==MATRIX_BACKEND?BITMATRIX_BACKEND:MATRIX_BACKEND)>=0||info->backend!=backend)
+		return(-1);
+
+	fresh.req = info->req;
+	if(make_coding_matrics(&fresh)<0)
+		return(-1);
+	fresh_coded = alloc_packets(n, coded_packet_size);
+	output = malloc(size_of_data);
+	plan = make_decode_plan(erasures, &fresh);
+	if(plan==NULL||set_coding_backend(&fresh, MATRIX_BACKEND)<0)
+		ret = -1;
+	if(ret>0&&(encode_rc(data, size_of_data, fresh_coded, coded_packet_size, &fresh)<0
+		||decode_rc_with_plan(fresh_coded, coded_packet_size, output, size_of_data, plan, &fresh)>=0))
+		ret = -1;
+	if(ret>0&&(decode_rc(fresh_coded, coded_packet_size, output, size_of_data, erasures, &fresh)<0
+		||memcmp(output, data, size_of_data)||set_coding_backend(&fresh, BITMATRIX_BACKEND)>=0))
+		ret = -1;
+	free_decode_plan(plan);
+	free_packets(fresh_coded, n);
+	free(output);
+	cleanup_matrics(&fresh);
+	return(ret);
+}
+
+static int run_check(char *check, int size_of_data, int coded_packet_size, struct coding_info *info)
+{
+	if(strcmp(check,"batch")==0)
+		return(check_batch(size_of_data, coded_packet_size, info));
+	if(strcmp(check,"stream")==0)
+		return(check_stream(size_of_data, info));
+	if(strcmp(check,"iov")==0)
+		return(check_iov(size_of_data, coded_packet_size, info));
+	if(strcmp(check,"read_only")==0)
+		return(check_read_only(size_of_data, coded_packet_size, info));
+	if(strcmp(check,"backend")==0)
+		return(check_backend(size_of_data, coded_packet_size, info));
+	usage("unrecognized RC_CHECK.");
+	return(-1);
+}
 
 int alloc_all_buffers(int size_of_data, int coded_packet_size, int repair_packet_size, struct coding_info *info)
 {
@@ -67,7 +453,6 @@ int alloc_all_buffers(int size_of_data, int coded_packet_size, int repair_packet
 	int k = info->req.k;
 	int d = info->req.d;
 	int i;   
-	long l;
 	data = malloc(size_of_data); 
 	repaired = malloc(coded_packet_size);
 	decoded_data = malloc(size_of_data);  	
@@ -85,10 +470,7 @@ int alloc_all_buffers(int size_of_data, int coded_packet_size, int repair_packet
 	erased = talloc(int, (n));
 	
 	// initialization
-	for(i=0 ; i<size_of_data/sizeof(long); i++){
-		l = lrand48(); l = (l << 32) | lrand48();
-		memcpy((long*)(data+i*sizeof(long)), &l, sizeof(long));
-	}
+	fill_random(data, size_of_data);
 	for (i = 0; i < n; i++) 
 		erased[i] = 0;
 	for (i = 0; i < n-k; ){
@@ -222,8 +604,64 @@ int main(int argc, char **argv)
 		printf("can not get coding requirements. Check parameters.\n");
 		exit(1);
 	}
+	// RC_LOW_DENSITY=1 searches the product-matrix codes for a coding matrix with fewer bitmatrix ones
+	char *low_density = getenv("RC_LOW_DENSITY");
+	if(low_density!=NULL)
+		info.req.low_density = atoi(low_density);
 	int coded_packet_size, repair_packet_size;	
-	make_coding_matrics(&info);
+	// RC_INFO_FILE names a file made by save_coding_info(), which is written if it can not be loaded
+	char *info_file = getenv("RC_INFO_FILE");
+	// RC_THREADS is the number of worker threads, in addition to the calling thread
+	char *threads = getenv("RC_THREADS");
+	if(threads!=NULL&&(pool=make_thread_pool(atoi(threads)))==NULL)
+		exit(1);
+	// RC_OPTIMIZE_SCHEDULES=1 schedules the bitmatrices with fewer XORs, and prints how many
+	char *optimize = getenv("RC_OPTIMIZE_SCHEDULES");
+	// RC_BACKEND=matrix codes with GF(2^w) region multiplication instead of the bitmatrix schedules. A loaded file 
+	// has to have been saved with the same backend.
+	char *backend = getenv("RC_BACKEND");
+	enum coding_backend coding_backend = (backend!=NULL&&strcmp(backend,"matrix")==0)?MATRIX_BACKEND:BITMATRIX_BACKEND;
+	if(info_file==NULL||load_coding_info(info_file,&info)<0){
+		make_coding_matrics(&info);
+		if(optimize!=NULL)
+			set_schedule_optimization(&info,atoi(optimize));
+		if(set_coding_backend(&info,coding_backend)<0)
+			exit(1);
+		if(info_file!=NULL)
+			save_coding_info(info_file,&info);
+	}
+	else if(set_coding_backend(&info,coding_backend)<0)
+		exit(1);
+	if(optimize!=NULL&&atoi(optimize)){
+		int i, xors, unoptimized;
+		for(i=0;i<=info.num_of_submatrices;i++){
+			if((xors=get_schedule_xors(&info,i,&unoptimized))>=0)
+				printf("schedule %d: %d XORs, %d unoptimized\n", i, xors, unoptimized);
+		}
+	}
+	// RC_COLLAPSED_DECODE=1 decodes in one pass with a map derived per erasure pattern, where the code supports it
+	char *collapsed = getenv("RC_COLLAPSED_DECODE");
+	if(collapsed!=NULL)
+		set_collapsed_decoding(&info,atoi(collapsed));
+	// RC_TILE_BYTES is the working set of the tiles of a decoding with several phases, 0 for whole subpackets
+	char *tile_bytes = getenv("RC_TILE_BYTES");
+	if(tile_bytes!=NULL)
+		set_tile_bytes(&info,atoi(tile_bytes));
+	// RC_MEMORY_BUDGET caps the scratch memory of a decoding, whatever the size of the stripes
+	char *memory_budget = getenv("RC_MEMORY_BUDGET");
+	if(memory_budget!=NULL)
+		set_memory_budget(&info,atoll(memory_budget));
+	// RC_XOR_KERNEL=0, 1, 2 or 3 forces the generic, SSE2, AVX2 or AVX-512 XOR kernel instead of the widest one
+	char *xor_kernel = getenv("RC_XOR_KERNEL");
+	if(xor_kernel!=NULL&&set_xor_kernel((enum xor_kernel)atoi(xor_kernel))<0)
+		exit(1);
+	// RC_STREAM_THRESHOLD is the size from which copies use non-temporal stores, 0 for never
+	char *stream_threshold = getenv("RC_STREAM_THRESHOLD");
+	if(stream_threshold!=NULL)
+		set_stream_threshold(atoi(stream_threshold));
+	// RC_CHECK=batch, stream, iov or read_only also checks the batched, streamed, scatter-gather or read-only coding
+	// against encode_rc and decode_rc, RC_CHECK=backend that the backend of a code that has coded can not be switched
+	char *check = getenv("RC_CHECK");
 	size_of_data = (int)(size_of_data/info.req.multiple_of)*info.req.multiple_of;
 	coded_packet_size = compute_coded_packet_size(&(info.req),size_of_data);
 	repair_packet_size = compute_repair_packet_size(&info.req,size_of_data);
@@ -244,18 +682,21 @@ int main(int argc, char **argv)
 
 		clk = clock();
 		//start testing: encode+decode
-		if(encode_rc(data, size_of_data, coded, coded_packet_size, &info)<0){
+		if(test_encode(data, size_of_data, coded, coded_packet_size, &info)<0){
 		 	printf("Failed to encode"); exit(1);
 		} 
 		enc_clk += clock()-clk;
 		//print_data_and_coding(n, codedPacketSize, coded);
 		clk = clock();
-		if(decode_rc(coded, coded_packet_size, decoded_data, size_of_data, erasures, &info)<0){
+		if(test_decode(coded, coded_packet_size, decoded_data, size_of_data, erasures, &info)<0){
 			printf("Failed to encode"); goto complete;
 		}  	
 		dec_clk += clock()-clk;
 		if(memcmp(data,decoded_data, size_of_data))
 			printf("Incorrected decoded.\n");
+		// before the repair, which reuses the erasures buffer
+		if(check!=NULL&&run_check(check, size_of_data, coded_packet_size, &info)<0)
+			printf("Incorrect %s coding.\n", check);
 		//else
 		//	printf("Complete testing encoding/decoding with no error.\n");
 		
@@ -267,7 +708,7 @@ int main(int argc, char **argv)
 				for(j=base, counter=0; j<base+v+1; j++){
 					if(j!=erased_ID){
 						helpers[counter] = j; 			  
-						if(repair_encode_rc(coded[j], coded_packet_size, repair_data[counter], repair_packet_size, j, erased_ID, &info)<0){
+						if(test_repair_encode(coded[j], coded_packet_size, repair_data[counter], repair_packet_size, j, erased_ID, &info)<0){
 							printf("Can not generate repair data"); goto complete;
 						}
 						counter++;
@@ -285,7 +726,7 @@ int main(int argc, char **argv)
 					if(i>erased_ID&&(i-erased_ID>info.req.f&&erased_ID+n-i>info.req.f))
 						continue;
 					helpers[counter] = i;
-					if(repair_encode_rc(coded[i], coded_packet_size, repair_data[counter], repair_packet_size, i, erased_ID, &info)<0){
+					if(test_repair_encode(coded[i], coded_packet_size, repair_data[counter], repair_packet_size, i, erased_ID, &info)<0){
 						printf("Can not generate repair data"); goto complete;
 					}
 					counter++;
@@ -312,7 +753,7 @@ int main(int argc, char **argv)
 				helpers[j] = -1;		
 		
 				for(i=0;i<info.req.d;i++){        
-					if(repair_encode_rc(coded[helpers[i]], coded_packet_size, repair_data[i], repair_packet_size, helpers[i], erased_ID, &info)<0){
+					if(test_repair_encode(coded[helpers[i]], coded_packet_size, repair_data[i], repair_packet_size, helpers[i], erased_ID, &info)<0){
 						printf("Can not generate repair data"); goto complete;
 					}
 				}  
@@ -337,7 +778,7 @@ int main(int argc, char **argv)
 				helpers[j] = -1;
 	
 				for(i=0;i<info.req.d;i++){        
-					if(repair_encode_rc(coded[helpers[i]], coded_packet_size, repair_data[i], repair_packet_size, helpers[i], erased_ID, &info)<0){
+					if(test_repair_encode(coded[helpers[i]], coded_packet_size, repair_data[i], repair_packet_size, helpers[i], erased_ID, &info)<0){
 						printf("Can not generate repair data"); goto complete;
 					}
 				}  
@@ -346,7 +787,7 @@ int main(int argc, char **argv)
 				helpers = erasures; // reuse erasure buffer for simplicity
 				for(j=0, i=(erased_ID+1)%n ;i!=erased_ID;i=(i+1)%n,j++){
 					helpers[j] = i;
-					if(repair_encode_rc(coded[i], coded_packet_size, repair_data[j], repair_packet_size, i, erased_ID, &info)<0){
+					if(test_repair_encode(coded[i], coded_packet_size, repair_data[j], repair_packet_size, i, erased_ID, &info)<0){
 						printf("Can not generate repair data"); goto complete;
 					}
 				}
@@ -357,7 +798,7 @@ int main(int argc, char **argv)
 		}	
 		rep_enc_clk += clock()-clk;
 		clk = clock();
-		if(repair_decode_rc(repair_data, repair_packet_size, repaired, coded_packet_size, erased_ID, helpers, &info)<0){
+		if(test_repair_decode(repair_data, repair_packet_size, repaired, coded_packet_size, erased_ID, helpers, &info)<0){
 			printf("Can not generate repair data"); goto complete;
 		}  
 		rep_dec_clk += clock()-clk;
@@ -369,6 +810,7 @@ int main(int argc, char **argv)
 	complete:		
 		free_all_buffers(&info);		
 	}
+	cleanup_thread_pool(pool);
 	cleanup_matrics(&info);
 /*
 	printf("Running codec=%d, n=%d, k=%d, w=%d, v=%d\n", atoi(argv[1]),n,k,w,v);
@@ -0,0 +1,121 @@
+/* 
+
+# thread_pool.c - a fixed set of worker threads that run the slabs of the parallel coding functions
+
+Copyright (c) 2026, the RegeneratingCodes contributors.
+
+Written for RegeneratingCodes after its original release, and distributed under the same terms as the rest
+of it, see LICENSE.
+
+# $Revision: 0.1 $
+# $Date: 2026/10/17 $
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include "thread_pool.h"
+
+// runs the tasks of the current job until none is left, called with pool->lock held
+static void run_tasks(struct thread_pool *pool)
+{
+	int index;
+	while(pool->next_task<pool->num_of_tasks){
+		index = pool->next_task++;
+		pthread_mutex_unlock(&pool->lock);
+		pool->task(pool->arg, index);
+		pthread_mutex_lock(&pool->lock);
+		if(--pool->pending==0)
+			pthread_cond_signal(&pool->work_done);
+	}
+}
+
+static void* worker(void *arg)
+{
+	struct thread_pool *pool = arg;
+	pthread_mutex_lock(&pool->lock);
+	while(!pool->shutdown){
+		if(pool->next_task<pool->num_of_tasks)
+			run_tasks(pool);
+		else
+			pthread_cond_wait(&pool->work_ready, &pool->lock);
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return(NULL);
+}
+
+struct thread_pool* make_thread_pool(int num_of_threads)
+{
+	int i;
+	struct thread_pool *pool;
+	if(num_of_threads<0){
+		printf("Invalid number of threads.\n");
+		return(NULL);
+	}
+	pool = calloc(1, sizeof(struct thread_pool));
+	if(pool==NULL){
+		printf("Out of memory.\n");
+		return(NULL);
+	}
+	pool->threads = malloc(sizeof(pthread_t)*(num_of_threads+1));
+	if(pool->threads==NULL){
+		printf("Out of memory.\n");
+		free(pool);
+		return(NULL);
+	}
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_mutex_init(&pool->run_lock, NULL);
+	pthread_cond_init(&pool->work_ready, NULL);
+	pthread_cond_init(&pool->work_done, NULL);
+	for(i=0;i<num_of_threads;i++){
+		if(pthread_create(&pool->threads[i], NULL, worker, pool)!=0){
+			printf("Can not create thread.\n");
+			break;
+		}
+		pool->num_of_threads++;
+	}
+	return(pool);
+}
+
+void cleanup_thread_pool(struct thread_pool *pool)
+{
+	int i;
+	if(pool==NULL)
+		return;
+	pthread_mutex_lock(&pool->lock);
+	pool->shutdown = 1;
+	pthread_cond_broadcast(&pool->work_ready);
+	pthread_mutex_unlock(&pool->lock);
+	for(i=0;i<pool->num_of_threads;i++)
+		pthread_join(pool->threads[i], NULL);
+	pthread_mutex_destroy(&pool->lock);
+	pthread_mutex_destroy(&pool->run_lock);
+	pthread_cond_destroy(&pool->work_ready);
+	pthread_cond_destroy(&pool->work_done);
+	free(pool->threads);
+	free(pool);
+}
+
+void thread_pool_run(struct thread_pool *pool, int num_of_tasks, void (*task)(void *arg, int index), void *arg)
+{
+	int i;
+	if(pool==NULL||pool->num_of_threads==0||num_of_tasks==1){
+		for(i=0;i<num_of_tasks;i++)
+			task(arg, i);
+		return;
+	}
+	pthread_mutex_lock(&pool->run_lock);
+	pthread_mutex_lock(&pool->lock);
+	pool->task = task;
+	pool->arg = arg;
+	pool->num_of_tasks = num_of_tasks;
+	pool->next_task = 0;
+	pool->pending = num_of_tasks;
+	pthread_cond_broadcast(&pool->work_ready);
+	run_tasks(pool);
+	while(pool->pending>0)
+		pthread_cond_wait(&pool->work_done, &pool->lock);
+	pool->num_of_tasks = 0;
+	pool->next_task = 0;
+	pthread_mutex_unlock(&pool->lock);
+	pthread_mutex_unlock(&pool->run_lock);
+}
@@ -0,0 +1,43 @@
+/* 
+
+# thread_pool.h - a fixed set of worker threads that run the slabs of the parallel coding functions
+
+Copyright (c) 2026, the RegeneratingCodes contributors.
+
+Written for RegeneratingCodes after its original release, and distributed under the same terms as the rest
+of it, see LICENSE.
+
+# $Revision: 0.1 $
+# $Date: 2026/10/17 $
+*/
+
+#ifndef CODING_THREAD_POOL
+#define CODING_THREAD_POOL
+
+#include <pthread.h>
+
+// Workers sleep on a condition variable until thread_pool_run() hands them a job, which is split 
+// into num_of_tasks tasks numbered from 0. The calling thread works on the tasks as well, and only
+// one job runs at a time, other callers wait for it to finish.
+struct thread_pool
+{
+	pthread_mutex_t lock;
+	pthread_mutex_t run_lock;	// held by the caller of thread_pool_run() for the whole job
+	pthread_cond_t work_ready;
+	pthread_cond_t work_done;
+	int num_of_threads;		// number of workers, not counting the caller
+	pthread_t* threads;
+	int shutdown;
+	// the current job
+	void (*task)(void *arg, int index);
+	void* arg;
+	int num_of_tasks;
+	int next_task;
+	int pending;			// tasks taken or not yet taken that have not completed
+};
+
+struct thread_pool* make_thread_pool(int num_of_threads);
+void cleanup_thread_pool(struct thread_pool *pool);
+void thread_pool_run(struct thread_pool *pool, int num_of_tasks, void (*task)(void *arg, int index), void *arg);
+
+#endif
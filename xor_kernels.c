@@ -0,0 +1,262 @@
+/* 
+
+# xor_kernels.c - XOR of regions with the widest SIMD instructions of the CPU
+
+Copyright (c) 2026, the RegeneratingCodes contributors.
+
+Written for RegeneratingCodes after its original release, and distributed under the same terms as the rest
+of it, see LICENSE.
+
+# $Revision: 0.1 $
+# $Date: 2026/10/17 $
+*/
+
+#include <stdio.h>
+#include <string.h>
+#include <stdint.h>
+#include "xor_kernels.h"
+
+#if defined(__x86_64__)||defined(__i386__)
+#include <immintrin.h>
+#define XOR_X86
+#endif
+
+// XORs bytes [pos,size) of the regions
+typedef void (*xor_function)(char **src, int num, char *dest, int pos, int size, int add);
+
+// the bytes [pos,size) that are left over by the vector loops
+static void xor_tail(char **src, int num, char *dest, int pos, int size, int add)
+{
+	int i;
+	char v;
+	for(;pos<size;pos++){
+		v = add?dest[pos]:0;
+		for(i=0;i<num;i++)
+			v ^= src[i][pos];
+		dest[pos] = v;
+	}
+}
+
+static void xor_generic(char **src, int num, char *dest, int pos, int size, int add)
+{
+	int i;
+	unsigned long v, s;
+	for(;pos+(int)sizeof(long)<=size;pos+=sizeof(long)){
+		if(add)
+			memcpy(&v,dest+pos,sizeof(long));
+		else
+			v = 0;
+		for(i=0;i<num;i++){
+			memcpy(&s,src[i]+pos,sizeof(long));
+			v ^= s;
+		}
+		memcpy(dest+pos,&v,sizeof(long));
+	}
+	xor_tail(src, num, dest, pos, size, add);
+}
+
+#ifdef XOR_X86
+// each kernel XORs four vectors at a time, so that the loop over the sources is amortized over 4 loads per source
+
+__attribute__((target("sse2")))
+static void xor_sse2(char **src, int num, char *dest, int pos, int size, int add)
+{
+	int i;
+	char *p;
+	__m128i v0, v1, v2, v3;
+	for(;pos+64<=size;pos+=64){
+		p = add?dest:src[0];
+		v0 = _mm_loadu_si128((__m128i*)(p+pos));
+		v1 = _mm_loadu_si128((__m128i*)(p+pos+16));
+		v2 = _mm_loadu_si128((__m128i*)(p+pos+32));
+		v3 = _mm_loadu_si128((__m128i*)(p+pos+48));
+		for(i=add?0:1;i<num;i++){
+			p = src[i]+pos;
+			v0 = _mm_xor_si128(v0,_mm_loadu_si128((__m128i*)p));
+			v1 = _mm_xor_si128(v1,_mm_loadu_si128((__m128i*)(p+16)));
+			v2 = _mm_xor_si128(v2,_mm_loadu_si128((__m128i*)(p+32)));
+			v3 = _mm_xor_si128(v3,_mm_loadu_si128((__m128i*)(p+48)));
+		}
+		_mm_storeu_si128((__m128i*)(dest+pos),v0);
+		_mm_storeu_si128((__m128i*)(dest+pos+16),v1);
+		_mm_storeu_si128((__m128i*)(dest+pos+32),v2);
+		_mm_storeu_si128((__m128i*)(dest+pos+48),v3);
+	}
+	xor_tail(src, num, dest, pos, size, add);
+}
+
+__attribute__((target("avx2")))
+static void xor_avx2(char **src, int num, char *dest, int pos, int size, int add)
+{
+	int i;
+	char *p;
+	__m256i v0, v1, v2, v3;
+	for(;pos+128<=size;pos+=128){
+		p = add?dest:src[0];
+		v0 = _mm256_loadu_si256((__m256i*)(p+pos));
+		v1 = _mm256_loadu_si256((__m256i*)(p+pos+32));
+		v2 = _mm256_loadu_si256((__m256i*)(p+pos+64));
+		v3 = _mm256_loadu_si256((__m256i*)(p+pos+96));
+		for(i=add?0:1;i<num;i++){
+			p = src[i]+pos;
+			v0 = _mm256_xor_si256(v0,_mm256_loadu_si256((__m256i*)p));
+			v1 = _mm256_xor_si256(v1,_mm256_loadu_si256((__m256i*)(p+32)));
+			v2 = _mm256_xor_si256(v2,_mm256_loadu_si256((__m256i*)(p+64)));
+			v3 = _mm256_xor_si256(v3,_mm256_loadu_si256((__m256i*)(p+96)));
+		}
+		_mm256_storeu_si256((__m256i*)(dest+pos),v0);
+		_mm256_storeu_si256((__m256i*)(dest+pos+32),v1);
+		_mm256_storeu_si256((__m256i*)(dest+pos+64),v2);
+		_mm256_storeu_si256((__m256i*)(dest+pos+96),v3);
+	}
+	xor_sse2(src, num, dest, pos, size, add); // never more than 127 bytes
+}
+
+__attribute__((target("avx512f")))
+static void xor_avx512(char **src, int num, char *dest, int pos, int size, int add)
+{
+	int i;
+	char *p;
+	__m512i v0, v1, v2, v3;
+	for(;pos+256<=size;pos+=256){
+		p = add?dest:src[0];
+		v0 = _mm512_loadu_si512((void*)(p+pos));
+		v1 = _mm512_loadu_si512((void*)(p+pos+64));
+		v2 = _mm512_loadu_si512((void*)(p+pos+128));
+		v3 = _mm512_loadu_si512((void*)(p+pos+192));
+		for(i=add?0:1;i<num;i++){
+			p = src[i]+pos;
+			v0 = _mm512_xor_si512(v0,_mm512_loadu_si512((void*)p));
+			v1 = _mm512_xor_si512(v1,_mm512_loadu_si512((void*)(p+64)));
+			v2 = _mm512_xor_si512(v2,_mm512_loadu_si512((void*)(p+128)));
+			v3 = _mm512_xor_si512(v3,_mm512_loadu_si512((void*)(p+192)));
+		}
+		_mm512_storeu_si512((void*)(dest+pos),v0);
+		_mm512_storeu_si512((void*)(dest+pos+64),v1);
+		_mm512_storeu_si512((void*)(dest+pos+128),v2);
+		_mm512_storeu_si512((void*)(dest+pos+192),v3);
+	}
+	xor_avx2(src, num, dest, pos, size, add);
+}
+
+// memcpy() with non-temporal stores: the head is copied up to the first 16-byte boundary of dest, then whole 64-byte
+// lines are streamed, SSE2 being enough to saturate the memory bandwidth, and the stores are fenced before the tail
+__attribute__((target("sse2")))
+static void stream_copy_sse2(char *dest, char *src, int size)
+{
+	int pos = (16-((uintptr_t)dest&15))&15;
+	__m128i v0, v1, v2, v3;
+	if(pos>size)
+		pos = size;
+	memcpy(dest,src,pos);
+	for(;pos+64<=size;pos+=64){
+		v0 = _mm_loadu_si128((__m128i*)(src+pos));
+		v1 = _mm_loadu_si128((__m128i*)(src+pos+16));
+		v2 = _mm_loadu_si128((__m128i*)(src+pos+32));
+		v3 = _mm_loadu_si128((__m128i*)(src+pos+48));
+		_mm_stream_si128((__m128i*)(dest+pos),v0);
+		_mm_stream_si128((__m128i*)(dest+pos+16),v1);
+		_mm_stream_si128((__m128i*)(dest+pos+32),v2);
+		_mm_stream_si128((__m128i*)(dest+pos+48),v3);
+	}
+	_mm_sfence();
+	memcpy(dest+pos,src+pos,size-pos);
+}
+#endif
+
+static xor_function xor_kernels[4];
+static enum xor_kernel current_kernel = XOR_GENERIC;
+static int stream_threshold = STREAM_THRESHOLD;
+
+static int cpu_supports(enum xor_kernel kernel)
+{
+#ifdef XOR_X86
+	__builtin_cpu_init();
+	switch(kernel){
+		case XOR_SSE2:
+			return(__builtin_cpu_supports("sse2"));
+		case XOR_AVX2:
+			return(__builtin_cpu_supports("avx2"));
+		case XOR_AVX512:
+			return(__builtin_cpu_supports("avx512f"));
+		default:
+			break;
+	}
+#endif
+	return(kernel==XOR_GENERIC);
+}
+
+// runs before main(), so that the kernel is fixed before any thread codes
+__attribute__((constructor))
+static void pick_xor_kernel(void)
+{
+	int kernel;
+
+	xor_kernels[XOR_GENERIC] = xor_generic;
+#ifdef XOR_X86
+	xor_kernels[XOR_SSE2] = xor_sse2;
+	xor_kernels[XOR_AVX2] = xor_avx2;
+	xor_kernels[XOR_AVX512] = xor_avx512;
+#endif
+	for(kernel=XOR_AVX512;kernel>XOR_GENERIC&&!cpu_supports(kernel);kernel--);
+	current_kernel = kernel;
+}
+
+void xor_regions(char **src, int num, char *dest, int size, int add)
+{
+	if(num<=0){
+		if(add==0)
+			memset(dest,0,size);
+		return;
+	}
+	xor_kernels[current_kernel](src, num, dest, 0, size, add);
+}
+
+void xor_region(char *src, char *dest, int size)
+{
+	xor_kernels[current_kernel](&src, 1, dest, 0, size, 1);
+}
+
+void copy_bytes(char *dest, char *src, int size)
+{
+#ifdef XOR_X86
+	if(stream_threshold>0&&size>=stream_threshold&&current_kernel>=XOR_SSE2){
+		stream_copy_sse2(dest, src, size);
+		return;
+	}
+#endif
+	memcpy(dest, src, size);
+}
+
+int get_stream_threshold(void)
+{
+	return(stream_threshold);
+}
+
+void set_stream_threshold(int size)
+{
+	stream_threshold = size<0?0:size;
+}
+
+enum xor_kernel get_xor_kernel(void)
+{
+	return(current_kernel);
+}
+
+int set_xor_kernel(enum xor_kernel kernel)
+{
+	if(kernel<XOR_GENERIC||kernel>XOR_AVX512||!cpu_supports(kernel)){
+		printf("This CPU does not support the %s XOR kernel.\n", get_xor_kernel_name(kernel));
+		return(-1);
+	}
+	current_kernel = kernel;
+	return(1);
+}
+
+const char* get_xor_kernel_name(enum xor_kernel kernel)
+{
+	static const char *names[4] = {"generic", "SSE2", "AVX2", "AVX-512"};
+	if(kernel<XOR_GENERIC||kernel>XOR_AVX512)
+		return("unknown");
+	return(names[kernel]);
+}
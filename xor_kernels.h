@@ -0,0 +1,47 @@
+/* 
+
+# xor_kernels.h - XOR of regions with the widest SIMD instructions of the CPU
+
+Copyright (c) 2026, the RegeneratingCodes contributors.
+
+Written for RegeneratingCodes after its original release, and distributed under the same terms as the rest
+of it, see LICENSE.
+
+# $Revision: 0.1 $
+# $Date: 2026/10/17 $
+*/
+
+#ifndef CODING_XOR_KERNELS
+#define CODING_XOR_KERNELS
+
+enum xor_kernel{
+	XOR_GENERIC,
+	XOR_SSE2,
+	XOR_AVX2,
+	XOR_AVX512
+};
+
+// dest = src[0]^src[1]^...^src[num-1], or dest ^= src[0]^...^src[num-1] if add is 1. The regions may have any 
+// alignment and size, and dest may be one of the sources.
+void xor_regions(char **src, int num, char *dest, int size, int add);
+// dest ^= src, with the same arguments as galois_region_xor()
+void xor_region(char *src, char *dest, int size);
+
+// dest = src for regions that do not overlap, like memcpy(). Copies of at least the stream threshold use 
+// non-temporal stores, which bypass the cache, so that moving large stripes does not evict the coding tables 
+// and the data being coded. The codecs copy a subpacket at a time, and a stripe has up to a few dozen of them, so 
+// the threshold is set well below the cache size: STREAM_THRESHOLD unless changed, so that the subpackets of 
+// a 64MB stripe (1.6MB or more in the configurations of the makefile) are streamed. 0 turns the non-temporal 
+// stores off.
+#define STREAM_THRESHOLD (1024*1024)
+void copy_bytes(char *dest, char *src, int size);
+int get_stream_threshold(void);
+void set_stream_threshold(int size);
+
+// the kernel is picked once at startup, the widest one the CPU supports. set_xor_kernel() fails if the CPU does 
+// not support the kernel, and must not be called while other threads are coding.
+enum xor_kernel get_xor_kernel(void);
+int set_xor_kernel(enum xor_kernel kernel);
+const char* get_xor_kernel_name(enum xor_kernel kernel);
+
+#endif